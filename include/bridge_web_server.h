@@ -0,0 +1,42 @@
+#ifndef BRIDGE_WEB_SERVER_H
+#define BRIDGE_WEB_SERVER_H
+
+#include <WebServer.h>
+#include <utility>
+#include "metrics.h"
+
+// WebServer that can hand the current client off so a handler can reply later
+class BridgeWebServer : public WebServer
+{
+public:
+    using WebServer::WebServer;
+
+    // Forward to every WebServer::send/send_P overload, noting the first 200 since boot
+    template <typename... Args>
+    void send(int code, Args &&...args)
+    {
+        if (code == 200)
+            recordBootMilestone(BOOT_FIRST_HTTP_OK);
+        WebServer::send(code, std::forward<Args>(args)...);
+    }
+
+    template <typename... Args>
+    void send_P(int code, Args &&...args)
+    {
+        if (code == 200)
+            recordBootMilestone(BOOT_FIRST_HTTP_OK);
+        WebServer::send_P(code, std::forward<Args>(args)...);
+    }
+
+    // Takes ownership of the current request's connection. The server treats
+    // the request as finished and moves on to the next client.
+    WiFiClient detachClient()
+    {
+        WiFiClient client = _currentClient;
+        _currentClient = WiFiClient();
+        _currentStatus = HC_NONE;
+        return client;
+    }
+};
+
+#endif
@@ -0,0 +1,55 @@
+#ifndef COMMAND_ENCODER_H
+#define COMMAND_ENCODER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef ARDUINO
+#include <WebSocketsClient.h>
+#else
+#define WEBSOCKETS_MAX_HEADER_SIZE 14 // Matches the WebSockets library
+#endif
+
+#define COMMAND_FRAME_SIZE 1024 // Room for the encoded frame, excluding the websocket header
+
+// Writes hm_get_command_queue frames straight into a fixed buffer. The inner
+// message and every command string are escaped in place, so nothing is
+// serialized twice and nothing touches the heap.
+class CommandEncoder
+{
+public:
+    void begin(const char *apiKey);
+
+    // Each add returns false, leaving the frame unchanged, if the command does not fit
+    bool addGetZones(uint32_t commandId);
+    bool addGetLiveData(uint32_t commandId);
+    bool addSetTemp(uint32_t commandId, const char *zone, float temperature);
+    bool addFrost(uint32_t commandId, const char *zone, bool on);
+
+    // Closes the envelope. Returns false if the frame overflowed.
+    bool finish();
+
+    // The frame is preceded by WEBSOCKETS_MAX_HEADER_SIZE spare bytes so it
+    // can be sent with headerToPayload and never copied again
+    uint8_t *payload() { return buffer + WEBSOCKETS_MAX_HEADER_SIZE; }
+    size_t length() const { return used; }
+    uint8_t commandCount() const { return commands; }
+
+private:
+    bool beginCommand();
+    bool endCommand(uint32_t commandId);
+    void put(char c);
+    void putEscaped(char c, uint8_t levels);
+    void putText(const char *text, uint8_t levels);
+    void putZone(const char *zone);
+    void putNumber(uint32_t value, uint8_t levels);
+    void putTemperature(float temperature);
+
+    uint8_t buffer[WEBSOCKETS_MAX_HEADER_SIZE + COMMAND_FRAME_SIZE];
+    size_t used;
+    size_t commandStart;
+    uint8_t commands;
+    bool overflow;
+};
+
+#endif
@@ -0,0 +1,43 @@
+#ifndef COMMAND_TRACKER_H
+#define COMMAND_TRACKER_H
+
+#include <Arduino.h>
+#include <functional>
+
+#define MAX_PENDING_COMMANDS 16 // Per hub; must be a power of two
+#define COMMAND_ID_HUB_SHIFT 24 // Command IDs carry their hub in the top byte
+#define COMMAND_TIMEOUT 5000    // Default reply timeout in milliseconds
+
+enum CommandType : uint8_t
+{
+    CMD_GET_ZONES,
+    CMD_GET_LIVE_DATA,
+    CMD_SET_TEMP,
+    CMD_FROST
+};
+
+enum CommandStatus : uint8_t
+{
+    COMMAND_OK,
+    COMMAND_FAILED,
+    COMMAND_TIMEOUT_EXPIRED
+};
+
+typedef std::function<void(uint32_t commandId, CommandStatus status)> CommandCallback;
+
+// Allocates a new command ID and tracks it until its reply arrives or the
+// timeout passes. Returns 0 if every slot of that hub is in flight.
+uint32_t registerCommand(uint8_t hub, CommandType type, unsigned long timeout, CommandCallback onComplete = nullptr);
+
+// Releases a command that never reached the hub, without running its callback
+void cancelCommand(uint32_t commandId);
+
+// Finishes a command and runs its callback. Ignored if it is no longer pending.
+void completeCommand(uint32_t commandId, CommandStatus status);
+
+bool isCommandPending(uint32_t commandId);
+
+// Times out overdue commands; call from loop()
+void expireCommands();
+
+#endif
@@ -1,8 +1,21 @@
 #ifndef CONFIG_H
 #define CONFIG_H
 
+#include <stdint.h>
+
 void saveConfig();
 void loadConfig();
 void startConfigMode();
 
+// Hub 0 is config.heatmiser_ip; the others come from config.extra_hubs
+uint8_t getHubCount();
+const char *getHubAddress(uint8_t hub);
+const char *getHubApiKey(uint8_t hub);
+
+// Zone names and last-known readings survive reboots so zone routes work
+// before the hub has answered
+void loadZoneCatalog();
+void saveZoneCatalog();
+void serviceZoneCatalog();
+
 #endif
\ No newline at end of file
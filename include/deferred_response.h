@@ -0,0 +1,27 @@
+#ifndef DEFERRED_RESPONSE_H
+#define DEFERRED_RESPONSE_H
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <functional>
+
+#define MAX_DEFERRED_RESPONSES 8 // Must be a power of two
+
+// Writes the reply for a parked request. timedOut is set when it was never resolved.
+typedef std::function<void(WiFiClient &client, bool timedOut)> DeferredHandler;
+
+// Parks the request currently being handled. The handler runs once the request
+// is resolved or the timeout passes, and the connection is closed afterwards.
+// Returns a handle, or 0 if every slot is taken.
+uint32_t deferResponse(unsigned long timeout, DeferredHandler handler);
+
+// Runs the handler of a parked request. Stale handles are ignored.
+void resolveDeferredResponse(uint32_t handle);
+
+// Times out parked requests and drops disconnected ones; call from loop()
+void serviceDeferredResponses();
+
+// Writes a complete HTTP/1.1 response with Connection: close
+void sendDeferredResponse(WiFiClient &client, int code, const char *contentType, const String &body);
+
+#endif
@@ -0,0 +1,22 @@
+#ifndef EVENT_STREAM_H
+#define EVENT_STREAM_H
+
+#include <Arduino.h>
+#include "zone_table.h"
+
+#define MAX_EVENT_SUBSCRIBERS 4
+#define EVENT_QUEUE_SIZE 1024       // Per-subscriber backlog; a subscriber that overflows it is dropped
+#define EVENT_KEEPALIVE_INTERVAL 15000
+
+// GET /events: turns the request into a Server-Sent Events stream, starting
+// with a snapshot of every cached zone
+void handleEventSubscribe();
+
+// Queues a zone's full state for every subscriber
+void publishZoneUpdate(const char *zoneName, const ZoneState &state);
+
+// Drains subscriber queues without blocking and keeps data flowing while
+// anyone is subscribed; call from loop()
+void serviceEventStreams();
+
+#endif
@@ -4,29 +4,47 @@
 #pragma once
 
 #include <WebServer.h>
+#include "bridge_web_server.h"
 #include <WebSocketsClient.h>
 #include <DNSServer.h>
-#include <map> // Add this line
 
 // Constants
-#define EEPROM_SIZE 512
+#define EEPROM_SIZE 4096
+#define ZONE_CATALOG_OFFSET 512 // Config lives below this
+#ifndef ZONE_CATALOG_SAVE_INTERVAL
+#define ZONE_CATALOG_SAVE_INTERVAL 3600000 // Readings alone are persisted at most hourly
+#endif
 #define AP_SSID "HeatmiserSetup"
 #define AP_PASSWORD "12345678"
 #define DNS_PORT 53
 #define CONFIG_MODE_TIMEOUT 300000         // 5 minutes in milliseconds
-#define HEATMISER_PORT 4243                // Correct Heatmiser port
-#define DEVICE_HOSTNAME "heatmiser-bridge" // Default hostname
+#ifndef HEATMISER_PORT
+#define HEATMISER_PORT 4243 // Correct Heatmiser port
+#endif
+#ifndef HEATMISER_USE_TLS
+#define HEATMISER_USE_TLS 1 // 0 talks plain websockets, e.g. to a local hub simulator
+#endif
+#ifndef MAX_HUBS
+#define MAX_HUBS 3 // Each hub costs a task, a TLS session and a command pipeline
+#endif
+#ifndef DEVICE_HOSTNAME
+#define DEVICE_HOSTNAME "heatmiser-bridge" // Default hostname; also baked into the setup page
+#endif
 
 // Global variables declarations
-extern WebServer server;
-extern WebSocketsClient webSocket;
+extern BridgeWebServer server;
 extern DNSServer dnsServer;
 extern bool isConfigMode;
 extern unsigned long configModeStartTime;
-extern bool endpointsCreated;
-extern unsigned long lastTempRequest;
 extern const unsigned long TEMP_TIMEOUT; // 2 seconds timeout
-extern std::map<String, float> temperatures;
+
+// A hub beyond the first; an empty ip marks the slot unused and an empty
+// api_key reuses the first hub's key
+struct HubConfig
+{
+    char ip[16];
+    char api_key[64];
+};
 
 // Configuration structure
 struct Config
@@ -36,6 +54,7 @@ struct Config
     char heatmiser_ip[16];
     char api_key[64];
     bool isConfigured;
+    HubConfig extra_hubs[MAX_HUBS - 1];
 };
 extern Config config;
 
@@ -0,0 +1,73 @@
+#ifndef HUB_TASK_H
+#define HUB_TASK_H
+
+#include <Arduino.h>
+#include "command_tracker.h"
+#include "zone_table.h"
+
+#ifndef HUB_TASK_CORE
+#define HUB_TASK_CORE 0 // loop() and the HTTP server run on core 1
+#endif
+#define HUB_TASK_STACK_SIZE 12288 // Per hub; TLS handshakes need most of this
+#define HUB_TASK_PRIORITY 1
+#define HUB_COMMAND_QUEUE_SIZE 16 // Must be a power of two
+#define HUB_EVENT_QUEUE_SIZE 128  // Per hub; must be a power of two; room for a full live data reply
+
+// A command on its way from the HTTP core to the hub task
+struct HubCommand
+{
+    uint32_t commandId;
+    CommandType type;
+    bool on;
+    float temperature;
+    char zone[MAX_ZONE_NAME];
+};
+
+enum HubEventType : uint8_t
+{
+    HUB_EVENT_CONNECTED,
+    HUB_EVENT_DISCONNECTED,
+    HUB_EVENT_ERROR,
+    HUB_EVENT_ZONE,
+    HUB_EVENT_READING,
+    HUB_EVENT_REPLY,
+    HUB_EVENT_PARSE_TIME,
+    HUB_EVENT_CONNECT_TIME
+};
+
+// A state update on its way from the hub task to the HTTP core
+struct HubEvent
+{
+    HubEventType type;
+    CommandStatus status; // HUB_EVENT_REPLY, and whether a HUB_EVENT_CONNECT_TIME attempt connected
+    uint32_t value;       // Command ID, zone device number, or parse/connect time in microseconds
+    float actualTemp;     // HUB_EVENT_READING
+    float setTemp;
+    uint8_t flags;        // ZoneState flags, or CONNECT_TLS_* for HUB_EVENT_CONNECT_TIME
+    char zone[MAX_ZONE_NAME];
+};
+
+// HUB_EVENT_CONNECT_TIME flags
+#define CONNECT_TLS_OFFERED 0x01 // A saved TLS session was offered
+#define CONNECT_TLS_RESUMED 0x02 // and the hub resumed it
+
+// Each hub's websocket, TLS session and reply parsing run in a task of their
+// own on HUB_TASK_CORE, so a slow or unreachable hub only ever blocks itself.
+// Everything else stays on the loop() core, so the command tracker, zone table
+// and temperature cache have a single writer and are read without locks.
+// The two sides only share one command queue and one event queue per hub.
+void startHubTasks();
+
+// HTTP core side
+bool postHubCommand(uint8_t hub, const HubCommand &command);
+void serviceHubEvents(); // Applies queued hub events; call from loop()
+bool isHubConnected(uint8_t hub);
+
+// Hub task side
+bool takeHubCommand(uint8_t hub, HubCommand &command);
+void postHubEvent(uint8_t hub, HubEventType type, uint32_t value = 0, CommandStatus status = COMMAND_OK,
+                  const char *zone = nullptr);
+void postHubReading(uint8_t hub, const LiveDeviceData &device);
+void postHubConnectTime(uint8_t hub, uint32_t micros, bool connected, uint8_t flags = 0);
+
+#endif
@@ -0,0 +1,78 @@
+#ifndef JSON_ARENA_H
+#define JSON_ARENA_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <ArduinoJson.h>
+
+#ifndef HUB_JSON_ARENA_SIZE
+#define HUB_JSON_ARENA_SIZE 4096 // Documents for one hub message
+#endif
+#ifndef HTTP_JSON_ARENA_SIZE
+#define HTTP_JSON_ARENA_SIZE 8192 // Documents and bodies for one HTTP response
+#endif
+
+// Bump allocator over a block reserved once at boot. Nothing is freed
+// individually; a scope rewinds everything allocated inside it, so the heap
+// never sees per-message allocations.
+class JsonArena
+{
+public:
+    JsonArena() : buffer(nullptr), capacity(0), used(0), last(0), peak(0) {}
+
+    bool reserve(size_t size);
+
+    // Returns nullptr when the arena is exhausted
+    void *allocate(size_t size);
+
+    // Only the most recent allocation can change size
+    void *reallocate(void *pointer, size_t size);
+
+    size_t mark() const { return used; }
+    void rewind(size_t position) { used = position; }
+
+    size_t getCapacity() const { return capacity; }
+    size_t getPeak() const { return peak; }
+
+private:
+    uint8_t *buffer;
+    size_t capacity;
+    size_t used;
+    size_t last; // Offset of the most recent allocation
+    size_t peak;
+};
+
+// Rewinds the arena to where it was when the scope was entered
+class ArenaScope
+{
+public:
+    explicit ArenaScope(JsonArena &arena) : arena(arena), position(arena.mark()) {}
+    ~ArenaScope() { arena.rewind(position); }
+
+private:
+    JsonArena &arena;
+    size_t position;
+};
+
+// Allocator for BasicJsonDocument<ArenaAllocator>
+struct ArenaAllocator
+{
+    explicit ArenaAllocator(JsonArena &arena) : arena(&arena) {}
+
+    void *allocate(size_t size) { return arena->allocate(size); }
+    void deallocate(void *) {}
+    void *reallocate(void *pointer, size_t size) { return arena->reallocate(pointer, size); }
+
+    JsonArena *arena;
+};
+
+typedef BasicJsonDocument<ArenaAllocator> ArenaJsonDocument;
+
+// Each arena has a single user: one per hub task, and one for the loop() HTTP server
+JsonArena &getHubJsonArena(uint8_t hub);
+extern JsonArena httpJsonArena;
+
+// Reserves the HTTP arena and one arena per configured hub
+void reserveJsonArenas(uint8_t hubCount);
+
+#endif
@@ -0,0 +1,33 @@
+#ifndef LIVE_DATA_PARSER_H
+#define LIVE_DATA_PARSER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define LIVE_DATA_MAX_ZONE_NAME 48
+
+// One device entry from a GET_LIVE_DATA reply. Fields missing from the
+// entry are left at zero/false; ZONE_NAME and ACTUAL_TEMP are required.
+struct LiveDeviceData
+{
+    char zoneName[LIVE_DATA_MAX_ZONE_NAME];
+    float actualTemp;
+    float setTemp;
+    bool heatOn;
+    bool standby;
+    bool holdOn;
+};
+
+typedef void (*LiveDeviceCallback)(const LiveDeviceData &device, void *context);
+
+// Streams the devices out of a raw hm_set_command_response payload in a single
+// pass, unescaping the nested "response" string on the fly. Uses a fixed amount
+// of stack regardless of the number of devices.
+// context is handed to every onDevice call.
+// Devices whose ZONE_NAME does not fit LIVE_DATA_MAX_ZONE_NAME are left out
+// and counted in skipped, if given.
+// Returns the number of devices reported, or -1 if the payload is malformed.
+int parseLiveData(const uint8_t *payload, size_t length, LiveDeviceCallback onDevice, void *context = nullptr,
+                  int *skipped = nullptr);
+
+#endif
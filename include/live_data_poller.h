@@ -0,0 +1,23 @@
+#ifndef LIVE_DATA_POLLER_H
+#define LIVE_DATA_POLLER_H
+
+#include <Arduino.h>
+
+#ifndef POLL_INTERVAL_MIN
+#define POLL_INTERVAL_MIN 2000 // Poll interval while values change or after a command
+#endif
+#ifndef POLL_INTERVAL_MAX
+#define POLL_INTERVAL_MAX 120000 // Upper bound of the backoff when the house is stable
+#endif
+#define POLL_AFTER_COMMAND_DELAY 1000 // Gives the hub time to apply a command before re-reading
+#define POLL_FRESHNESS_GRACE 5000     // Extra time cached readings stay fresh past the poll interval
+
+// Refreshes GET_LIVE_DATA from every hub in the background; call from loop()
+void servicePoller();
+
+// Switches a hub to fast polling after a SET_TEMP or FROST command
+void pollSoon(uint8_t hub);
+
+unsigned long getPollInterval(uint8_t hub);
+
+#endif
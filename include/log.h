@@ -0,0 +1,63 @@
+#ifndef LOG_H
+#define LOG_H
+
+#include <Arduino.h>
+
+#define LOG_LEVEL_NONE 0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN 2
+#define LOG_LEVEL_INFO 3
+#define LOG_LEVEL_DEBUG 4
+#define LOG_LEVEL_VERBOSE 5
+
+// Messages above BRIDGE_LOG_LEVEL are compiled out, arguments included
+#ifndef BRIDGE_LOG_LEVEL
+#define BRIDGE_LOG_LEVEL LOG_LEVEL_INFO
+#endif
+
+// Messages up to this level are also echoed to Serial
+#ifndef BRIDGE_LOG_SERIAL_LEVEL
+#define BRIDGE_LOG_SERIAL_LEVEL LOG_LEVEL_INFO
+#endif
+
+#define LOG_BUFFER_SIZE 4096 // Must be a power of two
+#define LOG_LINE_MAX 160
+
+// Formats a line into the in-RAM ring buffer
+void logWrite(uint8_t level, const char *format, ...) __attribute__((format(printf, 2, 3)));
+
+// Returns the buffered log, oldest first, as up to two contiguous segments.
+// Readers take no lock; a line being written at the same time may be cut short.
+size_t logSegments(const char *&first, size_t &firstLength, const char *&second, size_t &secondLength);
+
+#if BRIDGE_LOG_LEVEL >= LOG_LEVEL_ERROR
+#define LOG_ERROR(...) logWrite(LOG_LEVEL_ERROR, __VA_ARGS__)
+#else
+#define LOG_ERROR(...) ((void)0)
+#endif
+
+#if BRIDGE_LOG_LEVEL >= LOG_LEVEL_WARN
+#define LOG_WARN(...) logWrite(LOG_LEVEL_WARN, __VA_ARGS__)
+#else
+#define LOG_WARN(...) ((void)0)
+#endif
+
+#if BRIDGE_LOG_LEVEL >= LOG_LEVEL_INFO
+#define LOG_INFO(...) logWrite(LOG_LEVEL_INFO, __VA_ARGS__)
+#else
+#define LOG_INFO(...) ((void)0)
+#endif
+
+#if BRIDGE_LOG_LEVEL >= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(...) logWrite(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#else
+#define LOG_DEBUG(...) ((void)0)
+#endif
+
+#if BRIDGE_LOG_LEVEL >= LOG_LEVEL_VERBOSE
+#define LOG_VERBOSE(...) logWrite(LOG_LEVEL_VERBOSE, __VA_ARGS__)
+#else
+#define LOG_VERBOSE(...) ((void)0)
+#endif
+
+#endif
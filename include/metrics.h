@@ -0,0 +1,72 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <Arduino.h>
+#include "command_tracker.h"
+
+#define HISTOGRAM_MAX_BUCKETS 10
+
+// Fixed-bucket histogram of durations in microseconds
+struct Histogram
+{
+    const uint32_t *bounds; // Ascending upper bounds
+    uint8_t boundCount;
+    uint32_t counts[HISTOGRAM_MAX_BUCKETS + 1]; // Last one is +Inf
+    uint32_t samples;
+    uint64_t sum;
+};
+
+enum HttpRoute : uint8_t
+{
+    ROUTE_GET_TEMP,
+    ROUTE_GET_TEMP_DEFERRED,
+    ROUTE_ZONE_STATE,
+    ROUTE_HISTORY,
+    ROUTE_SET_TEMP,
+    ROUTE_STANDBY,
+    ROUTE_ZONES,
+    ROUTE_CACHE,
+    ROUTE_DEBUG_LOG,
+    ROUTE_METRICS,
+    ROUTE_NOT_FOUND,
+    ROUTE_COUNT
+};
+
+// Points in the boot sequence, each recorded once
+enum BootMilestone : uint8_t
+{
+    BOOT_WIFI_CONNECTED,
+    BOOT_HUB_CONNECTED,
+    BOOT_FIRST_HTTP_OK,
+    BOOT_MILESTONE_COUNT
+};
+
+void observeHistogram(Histogram &histogram, uint32_t value);
+
+void recordHttpLatency(HttpRoute route, uint32_t micros);
+void recordCommandRoundTrip(CommandType type, uint32_t micros);
+void recordCommandTimeout(CommandType type);
+void recordLiveDataParse(uint32_t micros);
+void recordHubConnect(uint8_t hub, uint32_t micros, bool connected, bool resumed = false); // TCP connect plus TLS handshake
+void recordTlsSessionOffer(uint8_t hub, bool resumed); // A reconnect offered the hub its last TLS session
+void recordWebSocketConnected(uint8_t hub);
+void recordWebSocketDisconnected(uint8_t hub);
+void recordWebSocketError(uint8_t hub);
+void recordBootMilestone(BootMilestone milestone);
+
+// Serves every metric in the Prometheus text format
+void handleMetrics();
+
+// Times a handler from construction to the end of its scope
+class RouteTimer
+{
+public:
+    explicit RouteTimer(HttpRoute route) : route(route), start(micros()) {}
+    ~RouteTimer() { recordHttpLatency(route, micros() - start); }
+
+private:
+    HttpRoute route;
+    unsigned long start;
+};
+
+#endif
@@ -1,6 +1,35 @@
 #ifndef NETWORK_H
 #define NETWORK_H
 
-void connectToNetwork();
+#include <stdint.h>
 
-#endif
\ No newline at end of file
+#ifndef NETWORK_CONNECT_TIMEOUT
+#define NETWORK_CONNECT_TIMEOUT 10000 // Give up on a join attempt after this long
+#endif
+#define NETWORK_BACKOFF_MIN 500
+#define NETWORK_BACKOFF_MAX 60000
+#ifndef NETWORK_NTP_SERVER
+#define NETWORK_NTP_SERVER "pool.ntp.org" // Sets the clock for history timestamps
+#endif
+
+// Optional static addressing skips DHCP, e.g.
+// -DNETWORK_STATIC_IP=\"192.168.1.50\" -DNETWORK_GATEWAY=\"192.168.1.1\"
+// -DNETWORK_SUBNET=\"255.255.255.0\" -DNETWORK_DNS=\"192.168.1.1\"
+
+enum NetworkState : uint8_t
+{
+    NETWORK_IDLE,
+    NETWORK_CONNECTING,
+    NETWORK_CONNECTED,
+    NETWORK_BACKOFF
+};
+
+// Starts joining the configured network without waiting for it
+void beginNetwork();
+
+// Advances the connection state machine; call from loop()
+void serviceNetwork();
+
+bool isNetworkConnected();
+
+#endif
@@ -0,0 +1,71 @@
+#ifndef TEMPERATURE_CACHE_H
+#define TEMPERATURE_CACHE_H
+
+#include <Arduino.h>
+#include "command_tracker.h"
+#include "zone_table.h"
+
+#ifndef TEMPERATURE_CACHE_TTL
+#define TEMPERATURE_CACHE_TTL 5000 // Readings younger than this are served without a refresh
+#endif
+#ifndef TEMPERATURE_CACHE_MAX_AGE
+#define TEMPERATURE_CACHE_MAX_AGE 600000 // Readings older than this count as missing
+#endif
+#define MAX_LIVE_DATA_WAITERS 8
+
+enum CacheResult : uint8_t
+{
+    CACHE_MISS,
+    CACHE_FRESH,
+    CACHE_STALE
+};
+
+struct TemperatureCacheStats
+{
+    uint32_t freshHits;
+    uint32_t staleHits;
+    uint32_t misses;
+    uint32_t upstreamFetches;
+    uint32_t coalescedFetches;
+};
+
+void setTemperatureCacheTtl(unsigned long ttl);
+unsigned long getTemperatureCacheTtl();
+
+// Effective TTL of a hub's zones: the configured one, or longer while a
+// background poller refreshes that hub at least this often
+unsigned long getHubCacheTtl(uint8_t hub);
+void setRefreshInterval(uint8_t hub, unsigned long interval);
+
+// Looks up a zone's cached state. Stale states are still returned;
+// the caller decides whether to revalidate them with refreshLiveData().
+CacheResult lookupZoneState(int zoneId, ZoneState &state);
+
+// Stores a zone's state from a hub's GET_LIVE_DATA reply and marks it
+// ZONE_HAS_STATE. Returns false if the zone is not in the zone table yet.
+bool storeZoneState(uint8_t hub, const char *localName, const ZoneState &state);
+
+// Updates a known zone in place, e.g. after the hub acknowledged a command.
+// ZONE_HAS_STATE is kept as the caller passes it.
+void updateZoneState(int zoneId, const ZoneState &state);
+
+// Seeds a reading persisted before the last reboot. It is served as stale
+// until the first live reply replaces it; only the temperature is known, so
+// the zone has no ZONE_HAS_STATE until then.
+void restoreTemperature(int zoneId, float temperature);
+
+// Requests GET_LIVE_DATA from a hub unless one is already in flight there, in
+// which case the caller joins it. onComplete runs when that single request
+// finishes. Each hub has its own request and waiters, so a slow hub never
+// holds up readers of another.
+uint32_t refreshLiveData(uint8_t hub, CommandCallback onComplete = nullptr);
+
+const TemperatureCacheStats &getTemperatureCacheStats();
+
+// Bumped whenever a stored reading actually changes; used for ETags
+uint32_t getZoneStateGeneration();
+
+// The same, counting only the zones of one hub
+uint32_t getHubStateGeneration(uint8_t hub);
+
+#endif
@@ -1,6 +1,17 @@
 #ifndef WEBSOCKETS_H
 #define WEBSOCKETS_H
 
-void setupWebSocket();
+#include <stddef.h>
+#include <stdint.h>
+
+// Calls shorter than this while disconnected were not connect attempts
+#define HUB_CONNECT_MIN_TIME 5000 // Microseconds
+
+// Begins one websocket client per configured hub
+void setupWebSockets();
+
+// Hub task side; each hub's client is only used from its own task
+void serviceWebSocket(uint8_t hub);
+bool sendWebSocketFrame(uint8_t hub, uint8_t *payload, size_t length);
 
 #endif
\ No newline at end of file
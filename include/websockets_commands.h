@@ -1,10 +1,36 @@
 #ifndef WEBSOCKETS_COMMANDS_H
 #define WEBSOCKETS_COMMANDS_H
 #include <Arduino.h>
+#include "command_tracker.h"
 
-void sendGetZonesCommand();
-void sendSetTemperatureCommand(String zone, float temperature);
-void sendStandbyCommand(String zone, bool on);
-void sendGetTemperatureCommand(String zoneName);
+#ifndef COMMAND_BATCH_WINDOW
+#define COMMAND_BATCH_WINDOW 20 // Milliseconds to collect commands into one frame; 0 sends at once
+#endif
+#define COMMAND_BATCH_MAX 8 // Commands per frame before the batch is flushed early
+
+// Called on the loop() core. Each hub task sends its queued commands together
+// in one COMMANDS frame once the batch window closes. Each returns its
+// COMMANDID, or 0 if it could not be queued.
+// onComplete runs when the hub replies to that command or it times out.
+uint32_t sendGetZonesCommand(uint8_t hub, CommandCallback onComplete = nullptr);
+
+// Zone commands go to the hub that owns the zone, under its name there
+uint32_t sendSetTemperatureCommand(int zoneId, float temperature, CommandCallback onComplete = nullptr);
+uint32_t sendStandbyCommand(int zoneId, bool on, CommandCallback onComplete = nullptr);
+
+// GET_LIVE_DATA covers every zone on the hub
+uint32_t sendGetTemperatureCommand(uint8_t hub, CommandCallback onComplete = nullptr);
+
+// Hub task side: sends every batched command of the hub now
+void flushCommands(uint8_t hub);
+
+// Collects commands from the hub's queue and flushes the batch once its
+// window has passed or it is full
+void serviceCommandQueue(uint8_t hub);
+
+// Finds the type of a command sent to the hub by ID. Also succeeds for
+// commands that already timed out, as long as their slot has not been
+// reused, so late replies still land.
+bool lookupSentCommand(uint8_t hub, uint32_t commandId, CommandType &type);
 
 #endif
\ No newline at end of file
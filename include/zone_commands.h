@@ -0,0 +1,25 @@
+#ifndef ZONE_COMMANDS_H
+#define ZONE_COMMANDS_H
+
+#include <Arduino.h>
+
+#ifndef COMMAND_SETTLE_WINDOW
+#define COMMAND_SETTLE_WINDOW 300 // A zone's command is sent once requests stop for this long
+#endif
+#define COMMAND_SETTLE_MAX 1000 // ...or at the latest this long after the first request
+
+// Per-zone, last-writer-wins set point and standby requests. Repeated
+// requests within the settle window collapse into one command, and a value
+// equal to the one in flight or last reported by the hub is not sent at all.
+// Returns false if the request was suppressed as a no-op.
+bool requestSetTemperature(int zoneId, float temperature);
+bool requestStandby(int zoneId, bool on);
+
+// Drops a zone's pending requests, e.g. when the zone is removed. A command
+// already sent is no longer applied to the zone when it is acknowledged.
+void forgetZoneCommands(int zoneId);
+
+// Sends settled requests; call from loop()
+void serviceZoneCommands();
+
+#endif
@@ -0,0 +1,28 @@
+#ifndef ZONE_DISCOVERY_H
+#define ZONE_DISCOVERY_H
+
+#include <Arduino.h>
+
+#ifndef ZONE_REFRESH_INTERVAL
+#define ZONE_REFRESH_INTERVAL 900000 // GET_ZONES is re-issued this often, besides on every reconnect
+#endif
+#define ZONE_REFRESH_MIN_INTERVAL 60000 // Lower bound for refreshes prompted by unknown zones
+
+// Keeps the zone table in step with each hub's zone list. Every GET_ZONES
+// reply is diffed against the zones of that hub: new zones are added,
+// renamed ones keep their ID, readings and history, and zones the hub no
+// longer reports are removed. Routes resolve names through the zone table,
+// so the HTTP server never needs to be touched.
+void refreshZoneCatalog(uint8_t hub);
+
+// Refreshes unless the last refresh started less than
+// ZONE_REFRESH_MIN_INTERVAL ago, e.g. when live data names an unknown zone
+void refreshZoneCatalogSoon(uint8_t hub);
+
+// One entry of the GET_ZONES reply in flight, in reply order
+void discoverZone(uint8_t hub, const char *localName, uint16_t deviceId);
+
+// Re-issues GET_ZONES to connected hubs every ZONE_REFRESH_INTERVAL; call from loop()
+void serviceZoneDiscovery();
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef ZONE_HISTORY_H
+#define ZONE_HISTORY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef HISTORY_BYTES_PER_ZONE
+#define HISTORY_BYTES_PER_ZONE 2048 // About a day of one-minute samples
+#endif
+#ifndef HISTORY_SAMPLE_INTERVAL
+#define HISTORY_SAMPLE_INTERVAL 60 // Seconds; at most one sample per zone per interval
+#endif
+#ifndef HISTORY_POOL_ZONES
+#define HISTORY_POOL_ZONES 24 // Zones that can keep history; the pool is reserved at boot
+#endif
+#define HISTORY_BLOCK_SIZE 64
+
+// Reserves one pool for every zone buffer before the heap fragments. If the
+// full pool doesn't fit, it is halved until it does.
+void reserveZoneHistory();
+
+// Appends a temperature sample for a zone. time is in seconds and must not go
+// backwards; it is rounded down to the HISTORY_SAMPLE_INTERVAL grid and the
+// first reading of each interval is kept. The zone takes a buffer from the pool on its first sample and
+// keeps it; once full, the oldest block of samples is dropped. Zones that find
+// the pool empty keep no history and count as an allocation failure.
+void recordZoneHistory(int zoneId, uint32_t time, float temperature);
+
+// Drops a zone's samples, e.g. when its ID is freed. The buffer is kept for
+// whichever zone reuses the ID.
+void clearZoneHistory(int zoneId);
+
+typedef void (*HistorySampleCallback)(uint32_t time, float temperature, void *context);
+
+// Calls onSample, oldest first, for every stored sample with from <= time < to
+void forEachZoneHistorySample(int zoneId, uint32_t from, uint32_t to, HistorySampleCallback onSample, void *context);
+
+// Bytes of the pool handed out to zones
+size_t getZoneHistoryMemory();
+
+// Zones that wanted a history buffer after the pool ran out
+uint32_t getZoneHistoryAllocationFailures();
+
+#endif
@@ -0,0 +1,7 @@
+#ifndef ZONE_ROUTES_H
+#define ZONE_ROUTES_H
+
+// Registers the single handler serving /<action>/<zone> for every zone
+void setupZoneRoutes();
+
+#endif
@@ -0,0 +1,70 @@
+#ifndef ZONE_TABLE_H
+#define ZONE_TABLE_H
+
+#include "live_data_parser.h"
+
+#define MAX_ZONES 64
+#define MAX_ZONE_NAME LIVE_DATA_MAX_ZONE_NAME
+
+// ZoneState flags
+#define ZONE_HAS_READING 0x01
+#define ZONE_HEAT_ON 0x02
+#define ZONE_STANDBY 0x04
+#define ZONE_HOLD_ON 0x08
+#define ZONE_HAS_STATE 0x10 // Set point and the flags above came from the hub
+
+// Live state of one zone. The table keeps each field in its own array;
+// this is only the form handed in and out.
+struct ZoneState
+{
+    float actualTemp;
+    float setTemp;
+    uint8_t flags;
+    uint32_t updatedAt; // millis() of the last reading
+};
+
+// Interns a zone reported by a hub and returns its ID. Known zones keep their
+// ID. Zones from different hubs share one namespace: a name already taken by
+// another hub is published as "Name (N)", N being the 1-based hub number.
+// Returns -1 if the table is full or the name is too long.
+int addHubZone(uint8_t hub, const char *localName);
+
+// Gives a zone a new hub-side name, keeping its ID and state. Returns false
+// if the name is taken or too long.
+bool renameZone(int zoneId, const char *localName);
+
+// Frees a zone's ID for reuse. Its name stops resolving at once.
+void removeZone(int zoneId);
+
+// The hub's own number for the zone, used to recognise renames; 0 if unknown
+void setZoneDeviceId(int zoneId, uint16_t deviceId);
+uint16_t getZoneDeviceId(int zoneId);
+
+// Finds a zone by the name its hub uses. Returns -1 if unknown.
+int findHubZone(uint8_t hub, const char *localName);
+
+// Finds a zone by its public name through a hash index. Returns -1 if unknown.
+int findZone(const char *name);
+
+// Returns nullptr for IDs not in use
+const char *getZoneName(int zoneId);
+uint8_t getZoneHub(int zoneId);
+
+// Copies the name the zone's hub knows it by. Returns false if unknown.
+bool copyZoneLocalName(int zoneId, char *out, size_t size);
+// Zone IDs run below this. Removed zones leave gaps until their IDs are
+// reused, so callers iterating IDs skip those without a name.
+int getZoneCount();
+
+// Copies out a zone's state. Returns false if the zone is unknown or has
+// never had a reading.
+bool getZoneState(int zoneId, ZoneState &state);
+
+// Stores a zone's state. Returns true if any value other than updatedAt changed.
+bool setZoneState(int zoneId, const ZoneState &state);
+
+// Bumped whenever a zone is added, renamed or removed; persisted catalogs
+// compare against it
+uint32_t getZoneCatalogGeneration();
+
+#endif
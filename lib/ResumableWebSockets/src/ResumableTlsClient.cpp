@@ -0,0 +1,152 @@
+#include "ResumableTlsClient.h"
+#include <WiFi.h>
+#include <lwip/sockets.h>
+#include <mbedtls/net_sockets.h>
+
+// mbedtls 3 marks the session fields private
+#ifndef MBEDTLS_PRIVATE
+#define MBEDTLS_PRIVATE(member) member
+#endif
+
+static const char personalization[] = "resumable_tls_client";
+
+void clearTlsSession(TlsSessionSlot &slot)
+{
+  slot.magic = 0;
+  slot.length = 0;
+}
+
+// Non-blocking TCP connect bounded by timeout. The socket stays non-blocking,
+// which is what WiFiClientSecure's read and available expect.
+bool ResumableTlsClient::openSocket(IPAddress address, uint16_t port, int32_t timeout)
+{
+  int fd = lwip_socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+  if (fd < 0)
+    return false;
+  sslclient->socket = fd;
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+
+  struct sockaddr_in server = {};
+  server.sin_family = AF_INET;
+  server.sin_addr.s_addr = (uint32_t)address;
+  server.sin_port = htons(port);
+  if (lwip_connect(fd, (struct sockaddr *)&server, sizeof(server)) < 0 && errno != EINPROGRESS)
+    return false;
+
+  fd_set writable;
+  FD_ZERO(&writable);
+  FD_SET(fd, &writable);
+  struct timeval wait = {timeout / 1000, (timeout % 1000) * 1000};
+  if (select(fd + 1, nullptr, &writable, nullptr, &wait) <= 0)
+    return false;
+
+  int error = 0;
+  socklen_t length = sizeof(error);
+  if (getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &length) < 0 || error)
+    return false;
+
+  int enable = 1;
+  lwip_setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+  lwip_setsockopt(fd, SOL_SOCKET, SO_KEEPALIVE, &enable, sizeof(enable));
+  return true;
+}
+
+int ResumableTlsClient::connect(const char *host, uint16_t port, int32_t timeout)
+{
+  offered = false;
+  resumed = false;
+  if (timeout <= 0)
+    timeout = 30000;
+
+  IPAddress address;
+  if (!WiFi.hostByName(host, address) || !openSocket(address, port, timeout))
+  {
+    stop();
+    return 0;
+  }
+
+  mbedtls_entropy_init(&sslclient->entropy_ctx);
+  int ret = mbedtls_ctr_drbg_seed(&sslclient->drbg_ctx, mbedtls_entropy_func, &sslclient->entropy_ctx,
+                                  (const unsigned char *)personalization, sizeof(personalization) - 1);
+  if (ret == 0)
+    ret = mbedtls_ssl_config_defaults(&sslclient->ssl_conf, MBEDTLS_SSL_IS_CLIENT, MBEDTLS_SSL_TRANSPORT_STREAM,
+                                      MBEDTLS_SSL_PRESET_DEFAULT);
+  if (ret == 0)
+  {
+    mbedtls_ssl_conf_authmode(&sslclient->ssl_conf, MBEDTLS_SSL_VERIFY_NONE);
+    mbedtls_ssl_conf_rng(&sslclient->ssl_conf, mbedtls_ctr_drbg_random, &sslclient->drbg_ctx);
+    ret = mbedtls_ssl_setup(&sslclient->ssl_ctx, &sslclient->ssl_conf);
+  }
+  if (ret == 0)
+    ret = mbedtls_ssl_set_hostname(&sslclient->ssl_ctx, host);
+  if (ret != 0)
+  {
+    log_e("TLS setup failed: -0x%04x", -ret);
+    stop();
+    return 0;
+  }
+
+  // A slot that does not load, e.g. from another mbedtls build, is dropped
+  mbedtls_ssl_session offeredSession;
+  mbedtls_ssl_session_init(&offeredSession);
+  if (slot.magic == TLS_SESSION_MAGIC && slot.length <= sizeof(slot.data))
+  {
+    offered = mbedtls_ssl_session_load(&offeredSession, slot.data, slot.length) == 0 &&
+              mbedtls_ssl_set_session(&sslclient->ssl_ctx, &offeredSession) == 0;
+    if (!offered)
+      clearTlsSession(slot);
+  }
+
+  mbedtls_ssl_set_bio(&sslclient->ssl_ctx, &sslclient->socket, mbedtls_net_send, mbedtls_net_recv, nullptr);
+
+  unsigned long start = millis();
+  while ((ret = mbedtls_ssl_handshake(&sslclient->ssl_ctx)) != 0)
+  {
+    if ((ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE) ||
+        millis() - start > sslclient->handshake_timeout)
+    {
+      log_e("TLS handshake failed: -0x%04x", -ret);
+      mbedtls_ssl_session_free(&offeredSession);
+      stop();
+      return 0;
+    }
+    vTaskDelay(2);
+  }
+
+  saveSession(offeredSession);
+  mbedtls_ssl_session_free(&offeredSession);
+  _connected = true;
+  return 1;
+}
+
+void ResumableTlsClient::saveSession(const mbedtls_ssl_session &offeredSession)
+{
+  mbedtls_ssl_session session;
+  mbedtls_ssl_session_init(&session);
+  if (mbedtls_ssl_get_session(&sslclient->ssl_ctx, &session) != 0)
+  {
+    mbedtls_ssl_session_free(&session);
+    return;
+  }
+
+  // A resumed session keeps its master secret; a full handshake derives a
+  // new one. This holds for session IDs and tickets alike.
+  resumed = offered && memcmp(session.MBEDTLS_PRIVATE(master), offeredSession.MBEDTLS_PRIVATE(master),
+                              sizeof(session.MBEDTLS_PRIVATE(master))) == 0;
+
+  // The magic goes last, so a restart halfway through leaves an empty slot
+  size_t length = 0;
+  clearTlsSession(slot);
+  int ret = mbedtls_ssl_session_save(&session, slot.data, sizeof(slot.data), &length);
+  if (ret == 0)
+  {
+    slot.length = length;
+    slot.magic = TLS_SESSION_MAGIC;
+  }
+  else
+  {
+    // Usually a peer certificate too big for TLS_SESSION_MAX_SIZE
+    log_w("TLS session not kept: -0x%04x, %u bytes", -ret, (unsigned)length);
+  }
+  mbedtls_ssl_session_free(&session);
+}
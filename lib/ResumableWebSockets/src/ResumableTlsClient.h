@@ -0,0 +1,47 @@
+#ifndef RESUMABLE_TLS_CLIENT_H
+#define RESUMABLE_TLS_CLIENT_H
+
+#include <WiFiClientSecure.h>
+
+#ifndef TLS_SESSION_MAX_SIZE
+#define TLS_SESSION_MAX_SIZE 1280 // Serialized session, the peer certificate included
+#endif
+#define TLS_SESSION_MAGIC 0x544C5331UL // "TLS1"
+
+// A session as mbedtls_ssl_session_save() writes it. Plain bytes, so a slot
+// can live in RTC memory and survive a software restart.
+struct TlsSessionSlot
+{
+  uint32_t magic; // TLS_SESSION_MAGIC once data holds a session
+  uint16_t length;
+  unsigned char data[TLS_SESSION_MAX_SIZE];
+};
+
+void clearTlsSession(TlsSessionSlot &slot);
+
+// WiFiClientSecure that offers the session saved in its slot when it
+// connects, and saves the session it ends up with for the next connect.
+// Certificates are not checked, as with setInsecure(): the neoHub's is
+// self-signed. The handshake otherwise follows the core's start_ssl_client().
+class ResumableTlsClient : public WiFiClientSecure
+{
+public:
+  explicit ResumableTlsClient(TlsSessionSlot &slot) : slot(slot) {}
+
+  int connect(const char *host, uint16_t port, int32_t timeout);
+
+  // Of the last connect: whether a saved session was offered, and whether
+  // the server accepted it instead of running a full handshake
+  bool sessionOffered() const { return offered; }
+  bool sessionResumed() const { return resumed; }
+
+private:
+  TlsSessionSlot &slot;
+  bool offered = false;
+  bool resumed = false;
+
+  bool openSocket(IPAddress address, uint16_t port, int32_t timeout);
+  void saveSession(const mbedtls_ssl_session &offeredSession);
+};
+
+#endif
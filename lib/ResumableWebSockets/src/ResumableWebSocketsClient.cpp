@@ -0,0 +1,34 @@
+#include "ResumableWebSocketsClient.h"
+
+void ResumableWebSocketsClient::loop()
+{
+  // Same checks as WebSocketsClient::loop() before it opens a connection
+  if (!sessionSlot || _port == 0 || !_client.isSSL || clientIsConnected(&_client) ||
+      millis() - _lastConnectionFail < _reconnectInterval)
+  {
+    WebSocketsClient::loop();
+    return;
+  }
+
+  if (_client.ssl)
+  {
+    delete _client.ssl;
+    _client.ssl = NULL;
+    _client.tcp = NULL;
+  }
+  ResumableTlsClient *tls = new ResumableTlsClient(*sessionSlot);
+  _client.ssl = tls;
+  _client.tcp = tls;
+
+  if (tls->connect(_host.c_str(), _port, WEBSOCKETS_TCP_TIMEOUT))
+  {
+    offered = tls->sessionOffered();
+    resumed = tls->sessionResumed();
+    connectedCb();
+  }
+  else
+  {
+    connectFailedCb();
+    _lastConnectionFail = millis();
+  }
+}
@@ -0,0 +1,29 @@
+#ifndef RESUMABLE_WEBSOCKETS_CLIENT_H
+#define RESUMABLE_WEBSOCKETS_CLIENT_H
+
+#include <WebSocketsClient.h>
+#include "ResumableTlsClient.h"
+
+// WebSocketsClient whose wss:// connects go through a ResumableTlsClient.
+// Only the connect in loop() is replaced; framing, heartbeats and
+// disconnects stay with the library. Relies on the protected members of
+// links2004/WebSockets 2.4.
+class ResumableWebSocketsClient : public WebSocketsClient
+{
+public:
+  // The slot must outlive the client. Without one, loop() is the library's.
+  void setSessionSlot(TlsSessionSlot *slot) { sessionSlot = slot; }
+
+  void loop();
+
+  // Of the last connect that succeeded
+  bool sessionOffered() const { return offered; }
+  bool sessionResumed() const { return resumed; }
+
+private:
+  TlsSessionSlot *sessionSlot = nullptr;
+  bool offered = false;
+  bool resumed = false;
+};
+
+#endif
@@ -0,0 +1,81 @@
+# Builds include/portal_html.h from web/portal.html: fills in the hostname,
+# strips indentation and line breaks, and gzips the page so the firmware can
+# serve it straight from flash.
+#
+# Runs before every build as a PlatformIO extra script, or by hand with
+#   python scripts/build_portal.py
+
+import gzip
+import os
+import re
+import zlib
+
+SOURCE = os.path.join("web", "portal.html")
+OUTPUT = os.path.join("include", "portal_html.h")
+DEFAULT_HOSTNAME_HEADER = os.path.join("include", "globals.h")
+
+
+def hostname_from_defines(defines):
+    for define in defines:
+        if isinstance(define, (list, tuple)) and define[0] == "DEVICE_HOSTNAME":
+            return str(define[1]).strip('\\"')
+    return None
+
+
+def default_hostname(project_dir):
+    with open(os.path.join(project_dir, DEFAULT_HOSTNAME_HEADER)) as header:
+        match = re.search(r'#define\s+DEVICE_HOSTNAME\s+"([^"]*)"', header.read())
+    return match.group(1) if match else "heatmiser-bridge"
+
+
+def build(project_dir, hostname=None):
+    hostname = hostname or default_hostname(project_dir)
+
+    with open(os.path.join(project_dir, SOURCE)) as source:
+        html = source.read()
+    html = html.replace("{{DEVICE_HOSTNAME}}", hostname)
+    html = "".join(line.strip() for line in html.splitlines())
+
+    # mtime=0 keeps the output identical between builds
+    compressed = gzip.compress(html.encode("utf-8"), compresslevel=9, mtime=0)
+    etag = "%08x" % (zlib.crc32(compressed) & 0xFFFFFFFF)
+
+    lines = []
+    for i in range(0, len(compressed), 16):
+        lines.append("    " + ", ".join("0x%02x" % b for b in compressed[i:i + 16]) + ",")
+
+    header = (
+        "// Generated by scripts/build_portal.py from web/portal.html; do not edit\n"
+        "#ifndef PORTAL_HTML_H\n"
+        "#define PORTAL_HTML_H\n"
+        "\n"
+        "#include <Arduino.h>\n"
+        "\n"
+        "#define PORTAL_HTML_ETAG \"\\\"%s\\\"\"\n"
+        "#define PORTAL_HTML_GZ_LENGTH %d // %d bytes before compression\n"
+        "\n"
+        "static const uint8_t PORTAL_HTML_GZ[] PROGMEM = {\n"
+        "%s\n"
+        "};\n"
+        "\n"
+        "#endif\n"
+    ) % (etag, len(compressed), len(html), "\n".join(lines))
+
+    output = os.path.join(project_dir, OUTPUT)
+    if os.path.exists(output):
+        with open(output) as existing:
+            if existing.read() == header:
+                return
+    with open(output, "w") as out:
+        out.write(header)
+    print("Generated %s (%d bytes gzipped)" % (OUTPUT, len(compressed)))
+
+
+try:
+    Import("env")  # noqa: F821 - provided by PlatformIO
+    # Pre-scripts run before build_flags reach CPPDEFINES, so parse them here
+    flags = env.ParseFlags(env.GetProjectOption("build_flags", ""))  # noqa: F821
+    build(env.subst("$PROJECT_DIR"), hostname_from_defines(flags.get("CPPDEFINES", [])))  # noqa: F821
+except NameError:
+    if __name__ == "__main__":
+        build(os.path.dirname(os.path.dirname(os.path.abspath(__file__))))
@@ -0,0 +1,186 @@
+# Stand-in for a Heatmiser neoHub on the host, for end-to-end tests of the
+# bridge without real hardware. Speaks the hub's websocket API: takes
+# hm_get_command_queue frames and answers every command in them with its own
+# hm_set_command_response.
+#
+# Answers GET_ZONES, GET_LIVE_DATA, SET_TEMP and FROST_ON/FROST_OFF for a
+# configurable number of zones, after a configurable reply delay. Point the
+# esp32dev_simulator build (plain websockets) at this host:
+#   pip install websockets
+#   python scripts/hub_simulator.py --zones 30 --delay 40
+# Pass --certfile/--keyfile to serve TLS like a real hub, for the esp32dev build.
+
+import argparse
+import ast
+import asyncio
+import json
+import random
+import ssl
+import time
+
+import websockets
+
+DEFAULT_PORT = 4243
+
+
+class Zone:
+    def __init__(self, name, device_id, temperature, set_temp):
+        self.name = name
+        self.device_id = device_id
+        self.temperature = temperature
+        self.set_temp = set_temp
+        self.standby = False
+
+    def live_data(self):
+        heat_on = not self.standby and self.temperature < self.set_temp
+        return {
+            "ACTUAL_TEMP": "%.1f" % self.temperature,
+            "DEVICE_ID": self.device_id,
+            "HEAT_ON": heat_on,
+            "HOLD_ON": False,
+            "OFFLINE": False,
+            "SET_TEMP": "%.1f" % self.set_temp,
+            "STANDBY": self.standby,
+            "THERMOSTAT": True,
+            "ZONE_NAME": self.name,
+        }
+
+
+class HubSimulator:
+    """Zone state and command handling for one simulated hub.
+
+    delay and live_data_delay are in seconds; live data is usually the slowest
+    command on a real hub. token, if set, must match every frame's token.
+    """
+
+    def __init__(self, zones=8, delay=0.0, live_data_delay=None, token=None, seed=None):
+        self.random = random.Random(seed)
+        self.zones = {}
+        for i in range(zones):
+            name = "Zone %d" % (i + 1)
+            self.zones[name] = Zone(name, i + 1, round(self.random.uniform(16, 23), 1), 20.0)
+        self.delay = delay
+        self.live_data_delay = delay if live_data_delay is None else live_data_delay
+        self.token = token
+        self.commands_handled = 0
+        self.connections = 0
+
+    def drift(self):
+        # Heating zones warm up, the rest cool down a little
+        for zone in self.zones.values():
+            heating = not zone.standby and zone.temperature < zone.set_temp
+            zone.temperature = round(zone.temperature + (0.1 if heating else -0.1) * self.random.random(), 1)
+
+    def execute(self, command):
+        """Runs one COMMAND string, e.g. {'SET_TEMP': [21.0,'Zone 1']}, and
+        returns the response document"""
+        try:
+            parsed = ast.literal_eval(command)
+            name, argument = next(iter(parsed.items()))
+        except (ValueError, SyntaxError, StopIteration, AttributeError):
+            return {"error": "Could not parse command"}
+
+        if name == "GET_ZONES":
+            return {zone.name: zone.device_id for zone in self.zones.values()}
+        if name == "GET_LIVE_DATA":
+            self.drift()
+            return {
+                "HUB_AWAY": False,
+                "HUB_HOLIDAY": False,
+                "HUB_TIME": int(time.time()),
+                "devices": [zone.live_data() for zone in self.zones.values()],
+            }
+        if name == "SET_TEMP":
+            temperature, zone = argument
+            if zone not in self.zones:
+                return {"error": "Could not find device %s" % zone}
+            self.zones[zone].set_temp = float(temperature)
+            return {"result": "temperature was set"}
+        if name in ("FROST_ON", "FROST_OFF"):
+            zones = argument if isinstance(argument, list) else [argument]
+            missing = [zone for zone in zones if zone not in self.zones]
+            if missing:
+                return {"error": "Could not find device %s" % missing[0]}
+            for zone in zones:
+                self.zones[zone].standby = name == "FROST_ON"
+            return {"result": "frost on" if name == "FROST_ON" else "frost off"}
+        return {"error": "Unknown command %s" % name}
+
+    async def reply(self, websocket, entry):
+        command = entry.get("COMMAND", "")
+        await asyncio.sleep(self.live_data_delay if "GET_LIVE_DATA" in command else self.delay)
+        response = self.execute(command)
+        self.commands_handled += 1
+        await websocket.send(json.dumps({
+            "command_id": entry.get("COMMANDID", 0),
+            "device_id": "NH-SIMULATOR",
+            "message_type": "hm_set_command_response",
+            "response": json.dumps(response),
+        }))
+
+    async def handle(self, websocket, path=None):
+        self.connections += 1
+        try:
+            await self.serve_frames(websocket)
+        except websockets.ConnectionClosed:
+            pass  # The bridge dropped the connection, e.g. on a WiFi blip
+
+    async def serve_frames(self, websocket):
+        async for frame in websocket:
+            try:
+                envelope = json.loads(frame)
+                message = json.loads(envelope["message"])
+            except (ValueError, KeyError, TypeError):
+                continue
+            if envelope.get("message_type") != "hm_get_command_queue":
+                continue
+            if self.token and message.get("token") != self.token:
+                await websocket.send(json.dumps({"message_type": "hm_set_command_response",
+                                                 "response": json.dumps({"error": "Invalid token"})}))
+                continue
+            # Commands are answered in order, like the hub does
+            for entry in message.get("COMMANDS", []):
+                await self.reply(websocket, entry)
+
+
+def server_ssl_context(certfile, keyfile):
+    context = ssl.SSLContext(ssl.PROTOCOL_TLS_SERVER)
+    context.load_cert_chain(certfile, keyfile)
+    return context
+
+
+async def serve(simulator, host="0.0.0.0", port=DEFAULT_PORT, ssl_context=None):
+    """Starts listening and returns the websockets server"""
+    return await websockets.serve(simulator.handle, host, port, ssl=ssl_context)
+
+
+async def run(args):
+    simulator = HubSimulator(zones=args.zones, delay=args.delay / 1000.0,
+                             live_data_delay=None if args.live_data_delay is None else args.live_data_delay / 1000.0,
+                             token=args.token, seed=args.seed)
+    context = server_ssl_context(args.certfile, args.keyfile) if args.certfile else None
+    server = await serve(simulator, args.host, args.port, context)
+    print("Simulating a hub with %d zones on %s://%s:%d" %
+          (args.zones, "wss" if context else "ws", args.host, args.port))
+    await server.wait_closed()
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Simulate a neoHub websocket API for the bridge")
+    parser.add_argument("--host", default="0.0.0.0")
+    parser.add_argument("--port", type=int, default=DEFAULT_PORT)
+    parser.add_argument("--zones", type=int, default=8, help="zones on the hub, named Zone 1..N")
+    parser.add_argument("--delay", type=float, default=0, help="reply delay per command in ms")
+    parser.add_argument("--live-data-delay", type=float, help="reply delay for GET_LIVE_DATA in ms; defaults to --delay")
+    parser.add_argument("--token", help="reject frames whose token differs")
+    parser.add_argument("--seed", type=int, help="seed for the starting temperatures and drift")
+    parser.add_argument("--certfile", help="serve TLS with this certificate, like a real hub")
+    parser.add_argument("--keyfile", help="private key for --certfile")
+    try:
+        asyncio.run(run(parser.parse_args()))
+    except KeyboardInterrupt:
+        pass
+
+
+if __name__ == "__main__":
+    main()
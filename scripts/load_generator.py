@@ -0,0 +1,169 @@
+# Drives the bridge's HTTP endpoints from several concurrent clients and
+# reports latency percentiles and throughput, so a firmware change can be
+# compared against a repeatable end-to-end workload:
+#   python scripts/load_generator.py --bridge heatmiser-bridge.local --duration 30 --concurrency 4
+# Zone names come from /zones unless given with --zone. Each request opens a
+# fresh connection, as the firmware's WebServer closes it after one reply.
+
+import argparse
+import http.client
+import json
+import math
+import random
+import threading
+import time
+import urllib.parse
+
+# Path templates and their share of the requests; {zone} is URL-encoded
+DEFAULT_MIX = {
+    "/get_temp/{zone}": 40,
+    "/zone/{zone}": 20,
+    "/zones": 20,
+    "/set_temp/{zone}?temp={temp}": 10,
+    "/metrics": 10,
+}
+
+
+def percentile(samples, fraction):
+    if not samples:
+        return 0.0
+    # Nearest rank
+    ordered = sorted(samples)
+    return ordered[max(0, math.ceil(fraction * len(ordered)) - 1)]
+
+
+def fetch(host, port, path, timeout):
+    """Returns (status, seconds); status is None when the request failed"""
+    start = time.perf_counter()
+    connection = http.client.HTTPConnection(host, port, timeout=timeout)
+    try:
+        connection.request("GET", path)
+        response = connection.getresponse()
+        response.read()
+        return response.status, time.perf_counter() - start
+    except (OSError, http.client.HTTPException):
+        return None, time.perf_counter() - start
+    finally:
+        connection.close()
+
+
+def discover_zones(host, port, timeout):
+    connection = http.client.HTTPConnection(host, port, timeout=timeout)
+    try:
+        connection.request("GET", "/zones")
+        response = connection.getresponse()
+        body = response.read()
+        if response.status != 200:
+            return []
+        return [zone["zone"] for zone in json.loads(body).get("zones", [])]
+    finally:
+        connection.close()
+
+
+class RouteStats:
+    def __init__(self):
+        self.latencies = []
+        self.errors = 0
+        self.statuses = {}
+
+
+class LoadGenerator:
+    def __init__(self, host, port, zones, mix=None, timeout=10.0, seed=None):
+        self.host = host
+        self.port = port
+        self.zones = zones
+        self.mix = mix or DEFAULT_MIX
+        self.timeout = timeout
+        self.random = random.Random(seed)
+        self.stats = {template: RouteStats() for template in self.mix}
+        self.lock = threading.Lock()
+
+    def pick(self, rng):
+        templates = list(self.mix)
+        template = rng.choices(templates, weights=[self.mix[t] for t in templates])[0]
+        zone = urllib.parse.quote(rng.choice(self.zones), safe="") if self.zones else ""
+        if "{zone}" in template and not zone:
+            template = "/zones"
+        return template, template.format(zone=zone, temp="%.1f" % rng.uniform(18, 22))
+
+    def worker(self, deadline, requests, seed):
+        rng = random.Random(seed)
+        while time.monotonic() < deadline and (requests is None or requests.acquire(blocking=False)):
+            template, path = self.pick(rng)
+            status, seconds = fetch(self.host, self.port, path, self.timeout)
+            with self.lock:
+                stats = self.stats[template]
+                if status is None or status >= 500:
+                    stats.errors += 1
+                else:
+                    stats.latencies.append(seconds)
+                stats.statuses[status] = stats.statuses.get(status, 0) + 1
+
+    def run(self, duration, concurrency, total=None):
+        """Runs for duration seconds, or until total requests have been made;
+        returns the elapsed wall time"""
+        requests = threading.Semaphore(total) if total else None
+        deadline = time.monotonic() + duration
+        threads = [threading.Thread(target=self.worker, args=(deadline, requests, self.random.random()))
+                   for _ in range(concurrency)]
+        start = time.perf_counter()
+        for thread in threads:
+            thread.start()
+        for thread in threads:
+            thread.join()
+        return time.perf_counter() - start
+
+    def summary(self, elapsed):
+        rows = []
+        everything = []
+        errors = 0
+        for template, stats in self.stats.items():
+            everything += stats.latencies
+            errors += stats.errors
+            if stats.latencies or stats.errors:
+                rows.append((template, stats.latencies, stats.errors))
+        rows.append(("all", everything, errors))
+
+        lines = ["%-32s %8s %7s %9s %9s %9s %9s" % ("route", "requests", "errors", "req/s", "p50 ms", "p99 ms", "max ms")]
+        for name, latencies, route_errors in rows:
+            count = len(latencies) + route_errors
+            lines.append("%-32s %8d %7d %9.1f %9.1f %9.1f %9.1f" % (
+                name, count, route_errors, count / elapsed if elapsed else 0,
+                percentile(latencies, 0.50) * 1000, percentile(latencies, 0.99) * 1000,
+                max(latencies) * 1000 if latencies else 0))
+        return "\n".join(lines)
+
+
+def parse_mix(text):
+    mix = {}
+    for item in text.split(","):
+        template, _, weight = item.rpartition("=")
+        mix[template] = int(weight)
+    return mix
+
+
+def main():
+    parser = argparse.ArgumentParser(description="HTTP load generator for the bridge")
+    parser.add_argument("--bridge", default="heatmiser-bridge.local", help="bridge host[:port]")
+    parser.add_argument("--duration", type=float, default=30, help="seconds to run")
+    parser.add_argument("--requests", type=int, help="stop after this many requests")
+    parser.add_argument("--concurrency", type=int, default=4, help="clients running at once")
+    parser.add_argument("--zone", action="append", help="zone to request; repeatable; default: all from /zones")
+    parser.add_argument("--mix", type=parse_mix, help="weighted path templates, e.g. '/zones=1,/get_temp/{zone}=3'")
+    parser.add_argument("--timeout", type=float, default=10, help="per-request timeout in seconds")
+    parser.add_argument("--seed", type=int)
+    args = parser.parse_args()
+
+    host, _, port = args.bridge.partition(":")
+    port = int(port or 80)
+    zones = args.zone or discover_zones(host, port, args.timeout)
+    if not zones:
+        print("No zones known; only zone-less routes will be requested")
+
+    generator = LoadGenerator(host, port, zones, args.mix, args.timeout, args.seed)
+    elapsed = generator.run(args.duration, args.concurrency, args.requests)
+    print(generator.summary(elapsed))
+
+
+if __name__ == "__main__":
+    main()
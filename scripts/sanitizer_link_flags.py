@@ -0,0 +1,9 @@
+# Passes the -fsanitize flags from build_flags on to the linker as well;
+# PlatformIO only hands them to the compiler.
+#
+# Used by the native_tsan environment as a post: extra script.
+
+Import("env")  # noqa: F821
+
+env.Append(LINKFLAGS=[flag for flag in env.get("CCFLAGS", [])  # noqa: F821
+                      if isinstance(flag, str) and flag.startswith("-fsanitize=")])
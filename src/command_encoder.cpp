@@ -0,0 +1,178 @@
+#include "command_encoder.h"
+#include <math.h>
+
+// Escape levels: 0 is the outer envelope, 1 the inner message embedded as a
+// string, 2 the contents of strings inside that message (token, COMMAND).
+
+void CommandEncoder::begin(const char *apiKey)
+{
+  used = 0;
+  commands = 0;
+  overflow = false;
+
+  putText("{\"message_type\":\"hm_get_command_queue\",\"message\":\"", 0);
+  putText("{\"token\":\"", 1);
+  putText(apiKey, 2);
+  putText("\",\"COMMANDS\":[", 1);
+}
+
+bool CommandEncoder::addGetZones(uint32_t commandId)
+{
+  if (!beginCommand())
+    return false;
+  putText("{'GET_ZONES': 1}", 2);
+  return endCommand(commandId);
+}
+
+bool CommandEncoder::addGetLiveData(uint32_t commandId)
+{
+  if (!beginCommand())
+    return false;
+  putText("{'GET_LIVE_DATA':1}", 2);
+  return endCommand(commandId);
+}
+
+bool CommandEncoder::addSetTemp(uint32_t commandId, const char *zone, float temperature)
+{
+  // {'SET_TEMP': [20.0,'Living Room']}
+  if (!beginCommand())
+    return false;
+  putText("{'SET_TEMP': [", 2);
+  putTemperature(temperature);
+  putText(",'", 2);
+  putZone(zone);
+  putText("']}", 2);
+  return endCommand(commandId);
+}
+
+bool CommandEncoder::addFrost(uint32_t commandId, const char *zone, bool on)
+{
+  // {'FROST_ON':['Living Room']}
+  if (!beginCommand())
+    return false;
+  putText(on ? "{'FROST_ON':['" : "{'FROST_OFF':['", 2);
+  putZone(zone);
+  putText("']}", 2);
+  return endCommand(commandId);
+}
+
+bool CommandEncoder::finish()
+{
+  putText("]}", 1);
+  putText("\"}", 0);
+  return !overflow;
+}
+
+bool CommandEncoder::beginCommand()
+{
+  if (overflow)
+    return false;
+
+  commandStart = used;
+  if (commands > 0)
+    putText(",", 1);
+  putText("{\"COMMAND\":\"", 1);
+  return true;
+}
+
+bool CommandEncoder::endCommand(uint32_t commandId)
+{
+  putText("\",\"COMMANDID\":", 1);
+  putNumber(commandId, 1);
+  putText("}", 1);
+
+  // Leave room to close the envelope; roll back a command that does not fit
+  if (overflow || used + 8 > COMMAND_FRAME_SIZE)
+  {
+    used = commandStart;
+    overflow = false;
+    return false;
+  }
+
+  commands++;
+  return true;
+}
+
+void CommandEncoder::put(char c)
+{
+  if (used < COMMAND_FRAME_SIZE)
+    payload()[used++] = c;
+  else
+    overflow = true;
+}
+
+// Writes c as it must appear after JSON-escaping it the given number of times
+void CommandEncoder::putEscaped(char c, uint8_t levels)
+{
+  if (levels == 0)
+  {
+    put(c);
+    return;
+  }
+
+  if (c == '"' || c == '\\')
+  {
+    putEscaped('\\', levels - 1);
+    putEscaped(c, levels - 1);
+  }
+  else if ((uint8_t)c < 0x20)
+  {
+    static const char hex[] = "0123456789abcdef";
+    putEscaped('\\', levels - 1);
+    putEscaped('u', levels - 1);
+    putEscaped('0', levels - 1);
+    putEscaped('0', levels - 1);
+    putEscaped(hex[(c >> 4) & 0xF], levels - 1);
+    putEscaped(hex[c & 0xF], levels - 1);
+  }
+  else
+  {
+    putEscaped(c, levels - 1);
+  }
+}
+
+void CommandEncoder::putText(const char *text, uint8_t levels)
+{
+  while (*text)
+    putEscaped(*text++, levels);
+}
+
+// Zone names sit inside single quotes in the hub's command syntax
+void CommandEncoder::putZone(const char *zone)
+{
+  while (*zone)
+  {
+    char c = *zone++;
+    if (c == '\'' || c == '\\')
+      putEscaped('\\', 2);
+    putEscaped(c, 2);
+  }
+}
+
+void CommandEncoder::putNumber(uint32_t value, uint8_t levels)
+{
+  char digits[10];
+  int count = 0;
+  do
+  {
+    digits[count++] = '0' + value % 10;
+    value /= 10;
+  } while (value);
+
+  while (count)
+    putEscaped(digits[--count], levels);
+}
+
+// One decimal place, as the hub expects: 20.0
+void CommandEncoder::putTemperature(float temperature)
+{
+  long tenths = lroundf(temperature * 10);
+  if (tenths < 0)
+  {
+    putEscaped('-', 2);
+    tenths = -tenths;
+  }
+  putNumber(tenths / 10, 2);
+  putEscaped('.', 2);
+  putEscaped('0' + tenths % 10, 2);
+}
@@ -0,0 +1,109 @@
+#include "command_tracker.h"
+#include "log.h"
+#include "metrics.h"
+#include "globals.h"
+
+struct PendingCommand
+{
+  uint32_t id;
+  CommandType type;
+  bool pending;
+  unsigned long sentAt;
+  unsigned long deadline;
+  CommandCallback onComplete;
+};
+
+#define COMMAND_SEQUENCE_MASK ((1UL << COMMAND_ID_HUB_SHIFT) - 1)
+
+// Each hub has its own slots, so a slow or silent hub can't starve the others
+static PendingCommand pendingCommands[MAX_HUBS][MAX_PENDING_COMMANDS];
+static uint32_t nextSequence[MAX_HUBS];
+
+// IDs map straight onto their hub and slot, so lookups never search the table
+static PendingCommand &slotFor(uint32_t commandId)
+{
+  uint8_t hub = commandId >> COMMAND_ID_HUB_SHIFT;
+  return pendingCommands[hub < MAX_HUBS ? hub : 0][commandId & (MAX_PENDING_COMMANDS - 1)];
+}
+
+uint32_t registerCommand(uint8_t hub, CommandType type, unsigned long timeout, CommandCallback onComplete)
+{
+  if (hub >= MAX_HUBS)
+    return 0;
+
+  // Skip IDs whose slot still holds an in-flight command
+  for (int i = 0; i < MAX_PENDING_COMMANDS; i++)
+  {
+    uint32_t sequence = ++nextSequence[hub] & COMMAND_SEQUENCE_MASK;
+    if (sequence == 0)
+      sequence = ++nextSequence[hub] & COMMAND_SEQUENCE_MASK;
+
+    uint32_t commandId = ((uint32_t)hub << COMMAND_ID_HUB_SHIFT) | sequence;
+    PendingCommand &slot = slotFor(commandId);
+    if (slot.pending)
+      continue;
+
+    slot.id = commandId;
+    slot.type = type;
+    slot.pending = true;
+    slot.sentAt = millis();
+    slot.deadline = slot.sentAt + timeout;
+    slot.onComplete = onComplete;
+    return commandId;
+  }
+
+  LOG_WARN("Hub %u command table full, dropping command", (unsigned)hub + 1);
+  return 0;
+}
+
+void cancelCommand(uint32_t commandId)
+{
+  PendingCommand &slot = slotFor(commandId);
+  if (commandId == 0 || slot.id != commandId)
+    return;
+
+  slot.pending = false;
+  slot.onComplete = nullptr;
+}
+
+void completeCommand(uint32_t commandId, CommandStatus status)
+{
+  PendingCommand &slot = slotFor(commandId);
+  if (commandId == 0 || slot.id != commandId || !slot.pending)
+    return;
+
+  slot.pending = false;
+  if (status == COMMAND_TIMEOUT_EXPIRED)
+    recordCommandTimeout(slot.type);
+  else
+    recordCommandRoundTrip(slot.type, (millis() - slot.sentAt) * 1000UL);
+
+  // The callback may register new commands, so release the slot first
+  CommandCallback onComplete = slot.onComplete;
+  slot.onComplete = nullptr;
+  if (onComplete)
+    onComplete(commandId, status);
+}
+
+bool isCommandPending(uint32_t commandId)
+{
+  PendingCommand &slot = slotFor(commandId);
+  return commandId != 0 && slot.id == commandId && slot.pending;
+}
+
+void expireCommands()
+{
+  unsigned long now = millis();
+  for (uint8_t hub = 0; hub < MAX_HUBS; hub++)
+  {
+    for (int i = 0; i < MAX_PENDING_COMMANDS; i++)
+    {
+      PendingCommand &slot = pendingCommands[hub][i];
+      if (slot.pending && (long)(now - slot.deadline) >= 0)
+      {
+        LOG_WARN("Command %lu timed out", (unsigned long)slot.id);
+        completeCommand(slot.id, COMMAND_TIMEOUT_EXPIRED);
+      }
+    }
+  }
+}
@@ -1,5 +1,39 @@
 #include <EEPROM.h>
+#include "log.h"
 #include "globals.h"
+#include "config.h"
+#include "zone_table.h"
+#include "temperature_cache.h"
+#include "portal_html.h"
+
+#define ZONE_CATALOG_MAGIC 0x5A434154UL // "ZCAT"
+#define ZONE_CATALOG_VERSION 3
+#define ZONE_CATALOG_NO_READING INT16_MIN
+
+// Persisted zone catalog, stored after Config
+struct ZoneCatalogHeader
+{
+  uint32_t magic;
+  uint16_t version;
+  uint16_t count;
+  uint32_t checksum; // CRC-32 over the entries
+};
+
+struct ZoneCatalogEntry
+{
+  char name[MAX_ZONE_NAME]; // As the hub knows it
+  uint8_t hub;
+  uint16_t deviceId;   // The hub's number for the zone, 0 if unknown
+  int16_t temperature; // tenths of a degree, or ZONE_CATALOG_NO_READING
+};
+
+static_assert(sizeof(Config) <= ZONE_CATALOG_OFFSET, "Config overlaps the zone catalog");
+static_assert(ZONE_CATALOG_OFFSET + sizeof(ZoneCatalogHeader) + MAX_ZONES * sizeof(ZoneCatalogEntry) <= EEPROM_SIZE,
+              "Zone catalog does not fit in EEPROM_SIZE");
+
+static uint32_t savedCatalogGeneration = 0;
+static uint32_t savedStateGeneration = 0;
+static unsigned long lastCatalogSave = 0;
 
 void saveConfig()
 {
@@ -20,40 +54,165 @@ void loadConfig()
     config.isConfigured = false;
     saveConfig();
   }
+
+  // Configs saved before extra hubs existed leave erased bytes there
+  for (HubConfig &hub : config.extra_hubs)
+  {
+    if ((uint8_t)hub.ip[0] == 0xFF)
+      memset(&hub, 0, sizeof(hub));
+    hub.ip[sizeof(hub.ip) - 1] = '\0';
+    hub.api_key[sizeof(hub.api_key) - 1] = '\0';
+  }
+}
+
+uint8_t getHubCount()
+{
+  uint8_t count = 1;
+  while (count < MAX_HUBS && config.extra_hubs[count - 1].ip[0])
+    count++;
+  return count;
+}
+
+const char *getHubAddress(uint8_t hub)
+{
+  return hub == 0 ? config.heatmiser_ip : config.extra_hubs[hub - 1].ip;
+}
+
+const char *getHubApiKey(uint8_t hub)
+{
+  if (hub == 0 || !config.extra_hubs[hub - 1].api_key[0])
+    return config.api_key;
+  return config.extra_hubs[hub - 1].api_key;
+}
+
+static uint32_t crc32Update(uint32_t crc, const uint8_t *data, size_t length)
+{
+  crc = ~crc;
+  while (length--)
+  {
+    crc ^= *data++;
+    for (int bit = 0; bit < 8; bit++)
+      crc = (crc >> 1) ^ (0xEDB88320UL & (0 - (crc & 1)));
+  }
+  return ~crc;
 }
 
+static int entryAddress(int index)
+{
+  return ZONE_CATALOG_OFFSET + sizeof(ZoneCatalogHeader) + index * sizeof(ZoneCatalogEntry);
+}
+
+static void invalidateZoneCatalog()
+{
+  ZoneCatalogHeader header = {};
+  EEPROM.put(ZONE_CATALOG_OFFSET, header);
+}
+
+void saveZoneCatalog()
+{
+  ZoneCatalogHeader header = {};
+  header.magic = ZONE_CATALOG_MAGIC;
+  header.version = ZONE_CATALOG_VERSION;
+
+  // Removed zones leave gaps in the IDs; the catalog is written without them
+  for (int zoneId = 0; zoneId < getZoneCount(); zoneId++)
+  {
+    ZoneCatalogEntry entry = {};
+    if (!copyZoneLocalName(zoneId, entry.name, sizeof(entry.name)))
+      continue;
+    entry.hub = getZoneHub(zoneId);
+    entry.deviceId = getZoneDeviceId(zoneId);
+
+    ZoneState state;
+    entry.temperature = getZoneState(zoneId, state)
+                            ? (int16_t)lroundf(state.actualTemp * 10)
+                            : ZONE_CATALOG_NO_READING;
+
+    header.checksum = crc32Update(header.checksum, (const uint8_t *)&entry, sizeof(entry));
+    EEPROM.put(entryAddress(header.count++), entry);
+  }
+
+  EEPROM.put(ZONE_CATALOG_OFFSET, header);
+  EEPROM.commit();
+
+  savedCatalogGeneration = getZoneCatalogGeneration();
+  savedStateGeneration = getZoneStateGeneration();
+  lastCatalogSave = millis();
+  LOG_INFO("Saved zone catalog (%u zones)", (unsigned)header.count);
+}
+
+void loadZoneCatalog()
+{
+  ZoneCatalogHeader header;
+  EEPROM.get(ZONE_CATALOG_OFFSET, header);
+
+  if (header.magic != ZONE_CATALOG_MAGIC || header.version != ZONE_CATALOG_VERSION || header.count > MAX_ZONES)
+  {
+    LOG_INFO("No saved zone catalog");
+    return;
+  }
+
+  // Verify the whole catalog before touching the zone table
+  uint32_t checksum = 0;
+  for (int i = 0; i < header.count; i++)
+  {
+    ZoneCatalogEntry entry;
+    EEPROM.get(entryAddress(i), entry);
+    checksum = crc32Update(checksum, (const uint8_t *)&entry, sizeof(entry));
+  }
+  if (checksum != header.checksum)
+  {
+    LOG_WARN("Saved zone catalog is corrupt, ignoring it");
+    return;
+  }
+
+  for (int i = 0; i < header.count; i++)
+  {
+    ZoneCatalogEntry entry;
+    EEPROM.get(entryAddress(i), entry);
+    entry.name[sizeof(entry.name) - 1] = '\0';
+
+    // Zones of hubs no longer configured are dropped
+    if (entry.hub >= getHubCount())
+      continue;
+
+    int zoneId = addHubZone(entry.hub, entry.name);
+    if (zoneId < 0)
+      continue;
+    setZoneDeviceId(zoneId, entry.deviceId);
+    if (entry.temperature != ZONE_CATALOG_NO_READING)
+      restoreTemperature(zoneId, entry.temperature / 10.0f);
+  }
+
+  savedCatalogGeneration = getZoneCatalogGeneration();
+  savedStateGeneration = getZoneStateGeneration();
+  lastCatalogSave = millis();
+  LOG_INFO("Restored %u zones from the saved catalog", (unsigned)header.count);
+}
+
+void serviceZoneCatalog()
+{
+  // The zone list is written as soon as it changes; readings alone only
+  // refresh the snapshot every ZONE_CATALOG_SAVE_INTERVAL to spare the flash
+  if (getZoneCatalogGeneration() != savedCatalogGeneration ||
+      (getZoneStateGeneration() != savedStateGeneration && millis() - lastCatalogSave > ZONE_CATALOG_SAVE_INTERVAL))
+    saveZoneCatalog();
+}
+
+// The page is built and gzipped at compile time by scripts/build_portal.py
 void handleRoot()
 {
-  String html = "<html><head>";
-  html += "<meta name='viewport' content='width=device-width, initial-scale=1'>";
-  html += "<style>";
-  html += "body { font-family: Arial, sans-serif; margin: 20px; }";
-  html += "input { width: 100%; padding: 12px 20px; margin: 8px 0; box-sizing: border-box; }";
-  html += "input[type=submit] { background-color: #4CAF50; color: white; border: none; cursor: pointer; }";
-  html += "input[type=submit]:hover { background-color: #45a049; }";
-  html += ".container { max-width: 500px; margin: auto; }";
-  html += ".info { background-color: #f8f9fa; padding: 15px; border-radius: 4px; margin-bottom: 20px; }";
-  html += "</style></head><body>";
-  html += "<div class='container'>";
-  html += "<h1>Heatmiser Neo Setup</h1>";
-  html += "<div class='info'>";
-  html += "<p>This device will be accessible as: <strong>" + String(DEVICE_HOSTNAME) + "</strong></p>";
-  html += "<p>You can find it on your network using this hostname or by scanning for this name.</p>";
-  html += "</div>";
-  html += "<form method='post' action='/configure'>";
-  html += "<label for='ssid'>WiFi Network Name:</label>";
-  html += "<input name='ssid' type='text' required><br>";
-  html += "<label for='password'>WiFi Password:</label>";
-  html += "<input name='password' type='password' required><br>";
-  html += "<label for='heatmiser_ip'>Heatmiser IP Address:</label>";
-  html += "<input name='heatmiser_ip' type='text' required placeholder='e.g., 192.168.1.100'><br>";
-  html += "<label for='api_key'>Heatmiser API Key:</label>";
-  html += "<input name='api_key' type='text' required><br>";
-  html += "<input type='submit' value='Save Configuration'>";
-  html += "</form>";
-  html += "</div></body></html>";
-
-  server.send(200, "text/html", html);
+  server.sendHeader("ETag", PORTAL_HTML_ETAG);
+  server.sendHeader("Cache-Control", "public, max-age=86400");
+
+  if (server.header("If-None-Match") == PORTAL_HTML_ETAG)
+  {
+    server.send(304);
+    return;
+  }
+
+  server.sendHeader("Content-Encoding", "gzip");
+  server.send_P(200, "text/html", (PGM_P)PORTAL_HTML_GZ, PORTAL_HTML_GZ_LENGTH);
 }
 
 void handleConfigure()
@@ -66,8 +225,25 @@ void handleConfigure()
     strncpy(config.wifi_password, server.arg("password").c_str(), sizeof(config.wifi_password));
     strncpy(config.heatmiser_ip, server.arg("heatmiser_ip").c_str(), sizeof(config.heatmiser_ip));
     strncpy(config.api_key, server.arg("api_key").c_str(), sizeof(config.api_key));
+
+    // Optional extra hubs, numbered from 2 in the form
+    memset(config.extra_hubs, 0, sizeof(config.extra_hubs));
+    uint8_t extraHubs = 0;
+    for (uint8_t hub = 2; hub <= MAX_HUBS; hub++)
+    {
+      String ip = server.arg("heatmiser_ip_" + String(hub));
+      ip.trim();
+      if (ip.isEmpty())
+        continue;
+
+      HubConfig &extra = config.extra_hubs[extraHubs++];
+      strncpy(extra.ip, ip.c_str(), sizeof(extra.ip) - 1);
+      strncpy(extra.api_key, server.arg("api_key_" + String(hub)).c_str(), sizeof(extra.api_key) - 1);
+    }
     config.isConfigured = true;
 
+    // The hub may have changed, so its old zones must not come back
+    invalidateZoneCatalog();
     saveConfig();
 
     server.send(200, "text/plain", "Configuration saved. Device will restart...");
@@ -89,6 +265,8 @@ void startConfigMode()
   dnsServer.start(DNS_PORT, "*", WiFi.softAPIP());
 
   // Setup web server routes
+  const char *headerKeys[] = {"If-None-Match"};
+  server.collectHeaders(headerKeys, sizeof(headerKeys) / sizeof(headerKeys[0]));
   server.on("/", handleRoot);
   server.on("/configure", HTTP_POST, handleConfigure);
 
@@ -101,21 +279,22 @@ void startConfigMode()
   server.begin();
 
   configModeStartTime = millis();
-  Serial.println("Configuration mode started");
-  Serial.println("Connect to WiFi network: " + String(AP_SSID));
-  Serial.println("Then access: http://192.168.4.1");
+  LOG_INFO("Configuration mode started");
+  LOG_INFO("Connect to WiFi network: %s", AP_SSID);
+  LOG_INFO("Then access: http://192.168.4.1");
 }
 
 void handleReset()
 {
-  Serial.println("Reset endpoint called");
+  LOG_INFO("Reset endpoint called");
 
   memset(&config, 0, sizeof(config));
   config.isConfigured = false;
+  invalidateZoneCatalog();
   saveConfig();
 
-  String response = "Configuration cleared. Device will restart in 2 seconds...";
-  Serial.println(response);
+  const char *response = "Configuration cleared. Device will restart in 2 seconds...";
+  LOG_INFO("%s", response);
   server.send(200, "text/plain", response);
 
   delay(2000);
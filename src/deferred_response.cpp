@@ -0,0 +1,114 @@
+#include "deferred_response.h"
+#include "metrics.h"
+#include "log.h"
+#include "globals.h"
+
+struct DeferredSlot
+{
+  uint32_t handle;
+  unsigned long deadline;
+  WiFiClient client;
+  DeferredHandler handler;
+};
+
+static DeferredSlot deferredSlots[MAX_DEFERRED_RESPONSES];
+static uint32_t deferredSequence = 0;
+
+static void finishDeferred(DeferredSlot &slot, bool timedOut)
+{
+  DeferredHandler handler = slot.handler;
+  WiFiClient client = slot.client;
+  slot.handle = 0;
+  slot.handler = nullptr;
+  slot.client = WiFiClient();
+
+  if (client.connected())
+    handler(client, timedOut);
+  client.stop();
+}
+
+uint32_t deferResponse(unsigned long timeout, DeferredHandler handler)
+{
+  for (uint32_t i = 0; i < MAX_DEFERRED_RESPONSES; i++)
+  {
+    DeferredSlot &slot = deferredSlots[i];
+    if (slot.handle)
+      continue;
+
+    // The low bits locate the slot, the rest tell reused slots apart
+    do
+    {
+      slot.handle = (++deferredSequence * MAX_DEFERRED_RESPONSES) | i;
+    } while (slot.handle < MAX_DEFERRED_RESPONSES);
+    slot.deadline = millis() + timeout;
+    slot.client = server.detachClient();
+    slot.handler = handler;
+    return slot.handle;
+  }
+
+  LOG_WARN("No free slot to park request");
+  return 0;
+}
+
+void resolveDeferredResponse(uint32_t handle)
+{
+  DeferredSlot &slot = deferredSlots[handle & (MAX_DEFERRED_RESPONSES - 1)];
+  if (handle && slot.handle == handle)
+    finishDeferred(slot, false);
+}
+
+void serviceDeferredResponses()
+{
+  unsigned long now = millis();
+  for (int i = 0; i < MAX_DEFERRED_RESPONSES; i++)
+  {
+    DeferredSlot &slot = deferredSlots[i];
+    if (!slot.handle)
+      continue;
+
+    if (!slot.client.connected())
+    {
+      // Client gave up; nothing left to answer
+      slot.handle = 0;
+      slot.handler = nullptr;
+      slot.client = WiFiClient();
+    }
+    else if ((long)(now - slot.deadline) >= 0)
+    {
+      finishDeferred(slot, true);
+    }
+  }
+}
+
+static const char *statusText(int code)
+{
+  switch (code)
+  {
+  case 200:
+    return "OK";
+  case 202:
+    return "Accepted";
+  case 404:
+    return "Not Found";
+  case 503:
+    return "Service Unavailable";
+  case 504:
+    return "Gateway Timeout";
+  default:
+    return "";
+  }
+}
+
+void sendDeferredResponse(WiFiClient &client, int code, const char *contentType, const String &body)
+{
+  String head = "HTTP/1.1 " + String(code) + " " + statusText(code) + "\r\n";
+  head += "Content-Type: " + String(contentType) + "\r\n";
+  head += "Content-Length: " + String(body.length()) + "\r\n";
+  head += "Connection: close\r\n\r\n";
+
+  client.write((const uint8_t *)head.c_str(), head.length());
+  client.write((const uint8_t *)body.c_str(), body.length());
+
+  if (code == 200)
+    recordBootMilestone(BOOT_FIRST_HTTP_OK);
+}
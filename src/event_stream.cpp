@@ -0,0 +1,226 @@
+#include "event_stream.h"
+#include <lwip/sockets.h>
+#include "zone_table.h"
+#include "log.h"
+#include "globals.h"
+
+struct EventSubscriber
+{
+  bool active;
+  WiFiClient client;
+  char queue[EVENT_QUEUE_SIZE];
+  uint16_t queueStart;
+  uint16_t queueLength;
+  unsigned long lastQueuedAt;
+  int snapshotNext; // Next zone ID of the initial snapshot, or -1 once it is queued
+};
+
+// Worst case for an escaped zone name: every character a \u00XX escape
+#define EVENT_MAX_ZONE_NAME (MAX_ZONE_NAME * 6)
+// A zone event with the longest possible, fully escaped name
+#define EVENT_MAX_SIZE (EVENT_MAX_ZONE_NAME + 160)
+
+static EventSubscriber subscribers[MAX_EVENT_SUBSCRIBERS];
+static uint8_t subscriberCount = 0;
+
+static void dropSubscriber(EventSubscriber &subscriber)
+{
+  subscriber.client.stop();
+  subscriber.client = WiFiClient();
+  subscriber.active = false;
+  subscriber.snapshotNext = -1;
+  subscriberCount--;
+}
+
+// Escapes a zone name for a JSON string. Control characters must not go out
+// raw: a newline would also end the event's data line early.
+static void escapeZoneName(char *escaped, size_t size, const char *zoneName)
+{
+  static const char special[] = "\"\\\b\f\n\r\t";
+  static const char replacement[] = "\"\\bfnrt";
+
+  size_t length = 0;
+  for (const char *c = zoneName; *c; c++)
+  {
+    const char *shortEscape = strchr(special, *c);
+    size_t needed = shortEscape ? 2 : (uint8_t)*c < 0x20 ? 6 : 1;
+    if (length + needed >= size)
+      break;
+
+    if (shortEscape)
+    {
+      escaped[length++] = '\\';
+      escaped[length++] = replacement[shortEscape - special];
+    }
+    else if (needed == 6)
+    {
+      snprintf(escaped + length, 7, "\\u%04x", (unsigned)*c);
+      length += 6;
+    }
+    else
+    {
+      escaped[length++] = *c;
+    }
+  }
+  escaped[length] = '\0';
+}
+
+// Formats one "zone" event. Set point and flags are left out until the hub
+// has reported them, as in /zone.
+static int formatZoneEvent(char *event, size_t size, const char *zoneName, const ZoneState &state)
+{
+  char escaped[EVENT_MAX_ZONE_NAME + 1];
+  escapeZoneName(escaped, sizeof(escaped), zoneName);
+
+  if (!(state.flags & ZONE_HAS_STATE))
+    return snprintf(event, size, "event: zone\ndata: {\"zone\":\"%s\",\"temperature\":%.1f}\n\n", escaped,
+                    state.actualTemp);
+  return snprintf(event, size,
+                  "event: zone\ndata: {\"zone\":\"%s\",\"temperature\":%.1f,\"set_temp\":%.1f,"
+                  "\"heat_on\":%s,\"standby\":%s,\"hold_on\":%s}\n\n",
+                  escaped, state.actualTemp, state.setTemp,
+                  (state.flags & ZONE_HEAT_ON) ? "true" : "false",
+                  (state.flags & ZONE_STANDBY) ? "true" : "false",
+                  (state.flags & ZONE_HOLD_ON) ? "true" : "false");
+}
+
+static bool enqueue(EventSubscriber &subscriber, const char *data, size_t length)
+{
+  if (subscriber.queueLength + length > EVENT_QUEUE_SIZE)
+    return false;
+
+  for (size_t i = 0; i < length; i++)
+    subscriber.queue[(subscriber.queueStart + subscriber.queueLength + i) % EVENT_QUEUE_SIZE] = data[i];
+  subscriber.queueLength += length;
+  subscriber.lastQueuedAt = millis();
+  return true;
+}
+
+static void publish(const char *data, size_t length)
+{
+  for (EventSubscriber &subscriber : subscribers)
+  {
+    if (subscriber.active && !enqueue(subscriber, data, length))
+    {
+      LOG_WARN("Dropping slow event subscriber");
+      dropSubscriber(subscriber);
+    }
+  }
+}
+
+void publishZoneUpdate(const char *zoneName, const ZoneState &state)
+{
+  if (subscriberCount == 0)
+    return;
+
+  char event[EVENT_MAX_SIZE];
+  int length = formatZoneEvent(event, sizeof(event), zoneName, state);
+  if (length > 0 && length < (int)sizeof(event))
+    publish(event, length);
+}
+
+void handleEventSubscribe()
+{
+  EventSubscriber *subscriber = nullptr;
+  for (EventSubscriber &candidate : subscribers)
+  {
+    if (!candidate.active)
+    {
+      subscriber = &candidate;
+      break;
+    }
+  }
+  if (!subscriber)
+  {
+    server.send(503, "text/plain", "Too many event subscribers");
+    return;
+  }
+
+  // Headers and snapshot go through the queue like every later event, so
+  // a slow reader never blocks the handler
+  static const char headers[] = "HTTP/1.1 200 OK\r\n"
+                                "Content-Type: text/event-stream\r\n"
+                                "Cache-Control: no-cache\r\n"
+                                "Connection: keep-alive\r\n\r\n";
+  subscriber->client = server.detachClient();
+  subscriber->queueStart = 0;
+  subscriber->queueLength = 0;
+  subscriber->snapshotNext = 0;
+  enqueue(*subscriber, headers, sizeof(headers) - 1);
+
+  subscriber->active = true;
+  subscriberCount++;
+  LOG_INFO("Event subscriber connected (%u active)", subscriberCount);
+}
+
+// Queues the initial snapshot a few zones at a time as the socket drains,
+// leaving half the queue free for live updates published meanwhile
+static void queueSnapshot(EventSubscriber &subscriber)
+{
+  char event[EVENT_MAX_SIZE];
+  ZoneState state;
+  while (subscriber.snapshotNext >= 0 && subscriber.queueLength < EVENT_QUEUE_SIZE / 2)
+  {
+    int zoneId = subscriber.snapshotNext;
+    if (zoneId >= getZoneCount())
+    {
+      subscriber.snapshotNext = -1;
+      break;
+    }
+
+    if (getZoneState(zoneId, state))
+    {
+      int length = formatZoneEvent(event, sizeof(event), getZoneName(zoneId), state);
+      if (length > 0 && length < (int)sizeof(event) && !enqueue(subscriber, event, length))
+        break;
+    }
+    subscriber.snapshotNext++;
+  }
+}
+
+static void flushSubscriber(EventSubscriber &subscriber)
+{
+  int fd = subscriber.client.fd();
+  while (fd >= 0 && subscriber.queueLength > 0)
+  {
+    // Hand the contiguous part of the ring to the socket without waiting;
+    // WiFiClient::write() would retry until all of it was sent
+    size_t chunk = min((size_t)subscriber.queueLength, (size_t)(EVENT_QUEUE_SIZE - subscriber.queueStart));
+    int written = send(fd, subscriber.queue + subscriber.queueStart, chunk, MSG_DONTWAIT);
+    if (written <= 0)
+      break;
+
+    subscriber.queueStart = (subscriber.queueStart + written) % EVENT_QUEUE_SIZE;
+    subscriber.queueLength -= written;
+  }
+}
+
+void serviceEventStreams()
+{
+  if (subscriberCount == 0)
+    return;
+
+  unsigned long now = millis();
+  for (EventSubscriber &subscriber : subscribers)
+  {
+    if (!subscriber.active)
+      continue;
+
+    if (!subscriber.client.connected())
+    {
+      LOG_INFO("Event subscriber disconnected");
+      dropSubscriber(subscriber);
+      continue;
+    }
+
+    // Comment lines keep proxies from timing out and reveal dead peers
+    if (now - subscriber.lastQueuedAt >= EVENT_KEEPALIVE_INTERVAL && !enqueue(subscriber, ":\n\n", 3))
+    {
+      dropSubscriber(subscriber);
+      continue;
+    }
+
+    queueSnapshot(subscriber);
+    flushSubscriber(subscriber);
+  }
+}
@@ -2,13 +2,9 @@
 #include "globals.h"
 
 // Global variables definitions
-WebServer server(80);
-WebSocketsClient webSocket;
+BridgeWebServer server(80);
 DNSServer dnsServer;
 bool isConfigMode = true;
 unsigned long configModeStartTime;
-bool endpointsCreated = false;
-unsigned long lastTempRequest = 0;
 const unsigned long TEMP_TIMEOUT = 2000; // 2 seconds timeout
-std::map<String, float> temperatures;
 Config config;
\ No newline at end of file
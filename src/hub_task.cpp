@@ -0,0 +1,169 @@
+#include "hub_task.h"
+#include "spsc_queue.h"
+#include "websockets.h"
+#include "websockets_commands.h"
+#include "temperature_cache.h"
+#include "zone_discovery.h"
+#include "metrics.h"
+#include "config.h"
+#include "log.h"
+#include "globals.h"
+
+struct HubSession
+{
+  SpscQueue<HubCommand, HUB_COMMAND_QUEUE_SIZE> commands;
+  SpscQueue<HubEvent, HUB_EVENT_QUEUE_SIZE> events;
+
+  // Only touched on the loop() core, in the order events arrive
+  bool connected;
+};
+
+// Allocated at boot for the configured hubs only
+static HubSession *sessions[MAX_HUBS];
+static uint8_t sessionCount = 0;
+
+static void hubTask(void *parameter)
+{
+  uint8_t hub = (uint8_t)(uintptr_t)parameter;
+  for (;;)
+  {
+    if (WiFi.status() == WL_CONNECTED)
+      serviceWebSocket(hub);
+    serviceCommandQueue(hub);
+
+    // Let the idle task run so the watchdog stays fed
+    vTaskDelay(1);
+  }
+}
+
+void startHubTasks()
+{
+  sessionCount = getHubCount();
+  for (uint8_t hub = 0; hub < sessionCount; hub++)
+    sessions[hub] = new HubSession();
+
+  for (uint8_t hub = 0; hub < sessionCount; hub++)
+  {
+    char name[8];
+    snprintf(name, sizeof(name), "hub%u", (unsigned)hub);
+    xTaskCreatePinnedToCore(hubTask, name, HUB_TASK_STACK_SIZE, (void *)(uintptr_t)hub, HUB_TASK_PRIORITY, nullptr, HUB_TASK_CORE);
+  }
+}
+
+bool postHubCommand(uint8_t hub, const HubCommand &command)
+{
+  return hub < sessionCount && sessions[hub]->commands.push(command);
+}
+
+bool takeHubCommand(uint8_t hub, HubCommand &command)
+{
+  return sessions[hub]->commands.pop(command);
+}
+
+static void pushEvent(uint8_t hub, const HubEvent &event)
+{
+  // Events must not be lost, so wait for loop() to make room
+  while (!sessions[hub]->events.push(event))
+    vTaskDelay(1);
+}
+
+void postHubEvent(uint8_t hub, HubEventType type, uint32_t value, CommandStatus status, const char *zone)
+{
+  HubEvent event = {};
+  event.type = type;
+  event.status = status;
+  event.value = value;
+  strncpy(event.zone, zone ? zone : "", sizeof(event.zone) - 1);
+  pushEvent(hub, event);
+}
+
+void postHubReading(uint8_t hub, const LiveDeviceData &device)
+{
+  HubEvent event = {};
+  event.type = HUB_EVENT_READING;
+  event.actualTemp = device.actualTemp;
+  event.setTemp = device.setTemp;
+  event.flags = ZONE_HAS_READING | (device.heatOn ? ZONE_HEAT_ON : 0) |
+                (device.standby ? ZONE_STANDBY : 0) | (device.holdOn ? ZONE_HOLD_ON : 0);
+  strncpy(event.zone, device.zoneName, sizeof(event.zone) - 1);
+  pushEvent(hub, event);
+}
+
+void postHubConnectTime(uint8_t hub, uint32_t micros, bool connected, uint8_t flags)
+{
+  HubEvent event = {};
+  event.type = HUB_EVENT_CONNECT_TIME;
+  event.status = connected ? COMMAND_OK : COMMAND_FAILED;
+  event.value = micros;
+  event.flags = flags;
+  pushEvent(hub, event);
+}
+
+static void applyHubEvent(uint8_t hub, const HubEvent &event)
+{
+  switch (event.type)
+  {
+  case HUB_EVENT_CONNECTED:
+    sessions[hub]->connected = true;
+    recordWebSocketConnected(hub);
+    recordBootMilestone(BOOT_HUB_CONNECTED);
+    refreshZoneCatalog(hub); // Zones may have changed while we were away
+    break;
+
+  case HUB_EVENT_DISCONNECTED:
+    sessions[hub]->connected = false;
+    recordWebSocketDisconnected(hub);
+    break;
+
+  case HUB_EVENT_ERROR:
+    recordWebSocketError(hub);
+    break;
+
+  case HUB_EVENT_ZONE:
+    discoverZone(hub, event.zone, event.value);
+    break;
+
+  case HUB_EVENT_READING:
+  {
+    ZoneState state;
+    state.actualTemp = event.actualTemp;
+    state.setTemp = event.setTemp;
+    state.flags = event.flags;
+    state.updatedAt = millis();
+    if (!storeZoneState(hub, event.zone, state))
+      refreshZoneCatalogSoon(hub); // New or renamed on the hub since the last GET_ZONES
+    break;
+  }
+
+  case HUB_EVENT_REPLY:
+    completeCommand(event.value, event.status);
+    break;
+
+  case HUB_EVENT_PARSE_TIME:
+    recordLiveDataParse(event.value);
+    break;
+
+  case HUB_EVENT_CONNECT_TIME:
+    recordHubConnect(hub, event.value, event.status == COMMAND_OK, event.flags & CONNECT_TLS_RESUMED);
+    if (event.status == COMMAND_OK && (event.flags & CONNECT_TLS_OFFERED))
+      recordTlsSessionOffer(hub, event.flags & CONNECT_TLS_RESUMED);
+    break;
+  }
+}
+
+void serviceHubEvents()
+{
+  // Bounded per hub so a burst of readings from one hub can neither hold up
+  // the HTTP server nor delay the events of the others
+  HubEvent event;
+  for (uint8_t hub = 0; hub < sessionCount; hub++)
+  {
+    for (int i = 0; i < HUB_EVENT_QUEUE_SIZE && sessions[hub]->events.pop(event); i++)
+      applyHubEvent(hub, event);
+  }
+}
+
+bool isHubConnected(uint8_t hub)
+{
+  return hub < sessionCount && sessions[hub]->connected;
+}
@@ -0,0 +1,56 @@
+#include "json_arena.h"
+#include <stdlib.h>
+#include <string.h>
+#include "globals.h"
+
+static JsonArena hubJsonArenas[MAX_HUBS];
+JsonArena httpJsonArena;
+
+// Keeps every allocation aligned for the pointers and floats inside documents
+#define ARENA_ALIGNMENT 8
+
+bool JsonArena::reserve(size_t size)
+{
+  buffer = (uint8_t *)malloc(size);
+  capacity = buffer ? size : 0;
+  used = last = 0;
+  return buffer != nullptr;
+}
+
+void *JsonArena::allocate(size_t size)
+{
+  size_t start = (used + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1);
+  if (start > capacity || size > capacity - start)
+    return nullptr;
+
+  last = start;
+  used = start + size;
+  if (used > peak)
+    peak = used;
+  return buffer + start;
+}
+
+void *JsonArena::reallocate(void *pointer, size_t size)
+{
+  if (!pointer)
+    return allocate(size);
+  if ((uint8_t *)pointer != buffer + last || size > capacity - last)
+    return nullptr;
+
+  used = last + size;
+  if (used > peak)
+    peak = used;
+  return pointer;
+}
+
+JsonArena &getHubJsonArena(uint8_t hub)
+{
+  return hubJsonArenas[hub];
+}
+
+void reserveJsonArenas(uint8_t hubCount)
+{
+  for (uint8_t hub = 0; hub < hubCount; hub++)
+    hubJsonArenas[hub].reserve(HUB_JSON_ARENA_SIZE);
+  httpJsonArena.reserve(HTTP_JSON_ARENA_SIZE);
+}
@@ -0,0 +1,490 @@
+#include "live_data_parser.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Decodes the body of a JSON string one character at a time
+class JsonStringDecoder
+{
+public:
+  JsonStringDecoder() : state(0), code(0), highSurrogate(0) {}
+
+  // Writes the decoded bytes for c to out and returns their count,
+  // or -1 when c is the closing quote.
+  int feed(char c, char *out)
+  {
+    if (state == 0)
+    {
+      if (c == '"')
+        return -1;
+      if (c == '\\')
+      {
+        state = 1;
+        return 0;
+      }
+      out[0] = c;
+      return 1;
+    }
+
+    if (state == 1)
+    {
+      state = 0;
+      switch (c)
+      {
+      case 'b':
+        out[0] = '\b';
+        return 1;
+      case 'f':
+        out[0] = '\f';
+        return 1;
+      case 'n':
+        out[0] = '\n';
+        return 1;
+      case 'r':
+        out[0] = '\r';
+        return 1;
+      case 't':
+        out[0] = '\t';
+        return 1;
+      case 'u':
+        state = 2;
+        code = 0;
+        return 0;
+      default: // '"', '\\' and '/'
+        out[0] = c;
+        return 1;
+      }
+    }
+
+    // Reading the four hex digits of a \u escape
+    int digit = hexValue(c);
+    if (digit < 0)
+    {
+      state = 0;
+      return 0;
+    }
+    code = (code << 4) | digit;
+    if (++state < 6)
+      return 0;
+
+    state = 0;
+    return encodeCodePoint(out);
+  }
+
+private:
+  static int hexValue(char c)
+  {
+    if (c >= '0' && c <= '9')
+      return c - '0';
+    if (c >= 'a' && c <= 'f')
+      return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+      return c - 'A' + 10;
+    return -1;
+  }
+
+  int encodeCodePoint(char *out)
+  {
+    uint32_t cp = code;
+    if (cp >= 0xD800 && cp <= 0xDBFF)
+    {
+      highSurrogate = code;
+      return 0;
+    }
+    if (cp >= 0xDC00 && cp <= 0xDFFF)
+    {
+      if (!highSurrogate)
+        return 0;
+      cp = 0x10000 + ((uint32_t)(highSurrogate - 0xD800) << 10) + (cp - 0xDC00);
+    }
+    highSurrogate = 0;
+
+    if (cp < 0x80)
+    {
+      out[0] = (char)cp;
+      return 1;
+    }
+    if (cp < 0x800)
+    {
+      out[0] = (char)(0xC0 | (cp >> 6));
+      out[1] = (char)(0x80 | (cp & 0x3F));
+      return 2;
+    }
+    if (cp < 0x10000)
+    {
+      out[0] = (char)(0xE0 | (cp >> 12));
+      out[1] = (char)(0x80 | ((cp >> 6) & 0x3F));
+      out[2] = (char)(0x80 | (cp & 0x3F));
+      return 3;
+    }
+    out[0] = (char)(0xF0 | (cp >> 18));
+    out[1] = (char)(0x80 | ((cp >> 12) & 0x3F));
+    out[2] = (char)(0x80 | ((cp >> 6) & 0x3F));
+    out[3] = (char)(0x80 | (cp & 0x3F));
+    return 4;
+  }
+
+  uint8_t state; // 0 plain, 1 after '\\', 2-5 reading \u digits
+  uint16_t code;
+  uint16_t highSurrogate;
+};
+
+enum LiveField : uint8_t
+{
+  FIELD_NONE,
+  FIELD_DEVICES,
+  FIELD_ZONE_NAME,
+  FIELD_ACTUAL_TEMP,
+  FIELD_SET_TEMP,
+  FIELD_HEAT_ON,
+  FIELD_STANDBY,
+  FIELD_HOLD_ON
+};
+
+struct LiveFieldName
+{
+  const char *key;
+  LiveField field;
+};
+
+// Device keys we keep; everything else is skipped without being buffered
+static const LiveFieldName deviceFields[] = {
+    {"ZONE_NAME", FIELD_ZONE_NAME},
+    {"ACTUAL_TEMP", FIELD_ACTUAL_TEMP},
+    {"SET_TEMP", FIELD_SET_TEMP},
+    {"HEAT_ON", FIELD_HEAT_ON},
+    {"STANDBY", FIELD_STANDBY},
+    {"HOLD_ON", FIELD_HOLD_ON},
+};
+
+#define LIVE_DATA_MAX_DEPTH 32
+
+// Tokenizes the inner GET_LIVE_DATA document and reports every entry of the
+// top-level "devices" array. Only the fields we keep are ever buffered.
+class LiveDataReader
+{
+public:
+  LiveDataReader(LiveDeviceCallback callback, void *context)
+      : onDevice(callback), context(context), containers(0), depth(0), devicesDepth(0),
+        inString(false), stringIsKey(false), inScalar(false), expectKey(false),
+        hasName(false), hasTemp(false), error(false), truncated(false), nameTooLong(false),
+        field(FIELD_NONE), tokenLength(0), count(0), skipped(0)
+  {
+  }
+
+  void feed(char c)
+  {
+    if (error)
+      return;
+
+    if (inString)
+    {
+      char decoded[4];
+      int n = decoder.feed(c, decoded);
+      if (n < 0)
+      {
+        inString = false;
+        if (stringIsKey)
+          endKey();
+        else
+          endValue();
+        return;
+      }
+      appendToken(decoded, n);
+      return;
+    }
+
+    if (inScalar)
+    {
+      if (c == ',' || c == '}' || c == ']' || c == ' ' || c == '\t' || c == '\n' || c == '\r')
+      {
+        inScalar = false;
+        endValue();
+      }
+      else
+      {
+        appendToken(&c, 1);
+        return;
+      }
+    }
+
+    switch (c)
+    {
+    case '{':
+    case '[':
+      openContainer(c == '[');
+      break;
+    case '}':
+    case ']':
+      closeContainer();
+      break;
+    case ':':
+      expectKey = false;
+      break;
+    case ',':
+      expectKey = depth > 0 && !topIsArray();
+      break;
+    case '"':
+      inString = true;
+      stringIsKey = expectKey;
+      tokenLength = 0;
+      truncated = false;
+      break;
+    case ' ':
+    case '\t':
+    case '\n':
+    case '\r':
+      break;
+    default:
+      inScalar = true;
+      tokenLength = 0;
+      truncated = false;
+      appendToken(&c, 1);
+      break;
+    }
+  }
+
+  int result() const
+  {
+    return (error || depth != 0) ? -1 : count;
+  }
+
+  int skippedCount() const
+  {
+    return skipped;
+  }
+
+private:
+  bool topIsArray() const
+  {
+    return (containers >> (depth - 1)) & 1;
+  }
+
+  bool atDeviceLevel() const
+  {
+    return devicesDepth > 0 && depth == devicesDepth + 1;
+  }
+
+  void openContainer(bool isArray)
+  {
+    if (depth >= LIVE_DATA_MAX_DEPTH)
+    {
+      error = true;
+      return;
+    }
+
+    bool opensDevices = isArray && depth == 1 && field == FIELD_DEVICES;
+    field = FIELD_NONE;
+
+    if (isArray)
+      containers |= (1UL << depth);
+    else
+      containers &= ~(1UL << depth);
+    depth++;
+    expectKey = !isArray;
+
+    if (opensDevices)
+    {
+      devicesDepth = depth;
+    }
+    else if (atDeviceLevel() && !isArray)
+    {
+      memset(&device, 0, sizeof(device));
+      hasName = false;
+      hasTemp = false;
+      nameTooLong = false;
+    }
+  }
+
+  void closeContainer()
+  {
+    if (depth == 0)
+    {
+      error = true;
+      return;
+    }
+
+    if (atDeviceLevel() && hasName && hasTemp)
+    {
+      onDevice(device, context);
+      count++;
+    }
+    else if (atDeviceLevel() && nameTooLong)
+    {
+      skipped++;
+    }
+    if (depth == devicesDepth)
+      devicesDepth = 0;
+
+    depth--;
+    field = FIELD_NONE;
+    expectKey = false;
+  }
+
+  void appendToken(const char *bytes, int n)
+  {
+    // Only keys and the values we keep need their characters
+    if (field == FIELD_NONE && !(inString && stringIsKey))
+      return;
+    if (tokenLength + n > sizeof(token) - 1)
+    {
+      truncated = true;
+      n = sizeof(token) - 1 - tokenLength;
+    }
+    for (int i = 0; i < n; i++)
+      token[tokenLength++] = bytes[i];
+  }
+
+  void endKey()
+  {
+    token[tokenLength] = '\0';
+    field = FIELD_NONE;
+    if (depth == 1 && strcmp(token, "devices") == 0)
+      field = FIELD_DEVICES;
+    else if (atDeviceLevel())
+    {
+      for (const LiveFieldName &candidate : deviceFields)
+      {
+        if (strcmp(token, candidate.key) == 0)
+        {
+          field = candidate.field;
+          break;
+        }
+      }
+    }
+  }
+
+  // Booleans are accepted as true/false or as numbers
+  static bool isTrue(const char *value)
+  {
+    return strcmp(value, "true") == 0 || strtol(value, nullptr, 10) != 0;
+  }
+
+  void endValue()
+  {
+    token[tokenLength] = '\0';
+    if (field == FIELD_ZONE_NAME)
+    {
+      // A cut-off name would never match the zone table, so the device is left out
+      memcpy(device.zoneName, token, tokenLength + 1);
+      hasName = !truncated;
+      nameTooLong = truncated;
+    }
+    else if (field == FIELD_ACTUAL_TEMP)
+    {
+      device.actualTemp = strtof(token, nullptr);
+      hasTemp = true;
+    }
+    else if (field == FIELD_SET_TEMP)
+      device.setTemp = strtof(token, nullptr);
+    else if (field == FIELD_HEAT_ON)
+      device.heatOn = isTrue(token);
+    else if (field == FIELD_STANDBY)
+      device.standby = isTrue(token);
+    else if (field == FIELD_HOLD_ON)
+      device.holdOn = isTrue(token);
+    field = FIELD_NONE;
+  }
+
+  LiveDeviceCallback onDevice;
+  void *context;
+  LiveDeviceData device;
+  JsonStringDecoder decoder;
+  uint32_t containers; // bit n is set when the container at depth n + 1 is an array
+  uint8_t depth;
+  uint8_t devicesDepth;
+  bool inString;
+  bool stringIsKey;
+  bool inScalar;
+  bool expectKey;
+  bool hasName;
+  bool hasTemp;
+  bool error;
+  bool truncated; // The current token lost characters that did not fit
+  bool nameTooLong;
+  LiveField field;
+  char token[LIVE_DATA_MAX_ZONE_NAME];
+  uint8_t tokenLength;
+  int count;
+  int skipped;
+};
+
+// Returns a pointer just past the opening quote of the top-level "response" string
+static const char *findResponseValue(const char *p, const char *end)
+{
+  int depth = 0;
+  bool expectKey = false;
+
+  while (p < end)
+  {
+    char c = *p++;
+    switch (c)
+    {
+    case '{':
+      depth++;
+      expectKey = true;
+      break;
+    case '[':
+      depth++;
+      expectKey = false;
+      break;
+    case '}':
+    case ']':
+      depth--;
+      break;
+    case ',':
+      expectKey = true;
+      break;
+    case ':':
+      expectKey = false;
+      break;
+    case '"':
+    {
+      const char *start = p;
+      while (p < end && *p != '"')
+        p += (*p == '\\') ? 2 : 1;
+      if (p >= end)
+        return nullptr;
+
+      bool isResponseKey = depth == 1 && expectKey && p - start == 8 &&
+                           memcmp(start, "response", 8) == 0;
+      p++; // closing quote
+      if (isResponseKey)
+      {
+        while (p < end && (*p == ' ' || *p == ':' || *p == '\t' || *p == '\n' || *p == '\r'))
+          p++;
+        return (p < end && *p == '"') ? p + 1 : nullptr;
+      }
+      break;
+    }
+    }
+  }
+  return nullptr;
+}
+
+int parseLiveData(const uint8_t *payload, size_t length, LiveDeviceCallback onDevice, void *context, int *skipped)
+{
+  const char *end = (const char *)payload + length;
+  const char *p = findResponseValue((const char *)payload, end);
+  if (!p)
+    return -1;
+
+  LiveDataReader reader(onDevice, context);
+  JsonStringDecoder envelope;
+  char decoded[4];
+
+  while (p < end)
+  {
+    int n = envelope.feed(*p++, decoded);
+    if (n < 0)
+    {
+      if (skipped)
+        *skipped = reader.skippedCount();
+      return reader.result();
+    }
+    for (int i = 0; i < n; i++)
+      reader.feed(decoded[i]);
+  }
+
+  // The response string was never closed
+  return -1;
+}
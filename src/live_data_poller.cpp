@@ -0,0 +1,70 @@
+#include "live_data_poller.h"
+#include "temperature_cache.h"
+#include "hub_task.h"
+#include "config.h"
+#include "log.h"
+#include "globals.h"
+
+// Each hub backs off on its own, so a quiet hub is not polled as often as a busy one
+struct HubPoller
+{
+  unsigned long pollInterval;
+  unsigned long nextPollAt;
+  bool pollInFlight;
+};
+static HubPoller pollers[MAX_HUBS];
+
+static void schedulePoll(uint8_t hub, unsigned long delay)
+{
+  HubPoller &poller = pollers[hub];
+  poller.nextPollAt = millis() + delay;
+
+  // Readings stay fresh until the next poll lands, so cache reads do not
+  // trigger their own upstream fetches in between
+  setRefreshInterval(hub, poller.pollInterval + POLL_FRESHNESS_GRACE);
+}
+
+void pollSoon(uint8_t hub)
+{
+  pollers[hub].pollInterval = POLL_INTERVAL_MIN;
+  if (!pollers[hub].pollInFlight)
+    schedulePoll(hub, POLL_AFTER_COMMAND_DELAY);
+}
+
+static void servicePoller(uint8_t hub)
+{
+  HubPoller &poller = pollers[hub];
+  if (poller.pollInFlight || !isHubConnected(hub) || (long)(millis() - poller.nextPollAt) < 0)
+    return;
+
+  uint32_t generation = getHubStateGeneration(hub);
+  poller.pollInFlight = true;
+  refreshLiveData(hub, [hub, generation](uint32_t, CommandStatus status)
+                  {
+    HubPoller &poller = pollers[hub];
+    poller.pollInFlight = false;
+
+    // Poll fast while values move, back off exponentially while they do not
+    if (status == COMMAND_OK && getHubStateGeneration(hub) == generation)
+      poller.pollInterval = min(poller.pollInterval * 2, (unsigned long)POLL_INTERVAL_MAX);
+    else
+      poller.pollInterval = POLL_INTERVAL_MIN;
+
+    LOG_DEBUG("Next live data poll of hub %u in %lu ms", (unsigned)hub + 1, poller.pollInterval);
+    schedulePoll(hub, poller.pollInterval); });
+}
+
+void servicePoller()
+{
+  for (uint8_t hub = 0; hub < getHubCount(); hub++)
+  {
+    if (pollers[hub].pollInterval == 0)
+      pollers[hub].pollInterval = POLL_INTERVAL_MIN;
+    servicePoller(hub);
+  }
+}
+
+unsigned long getPollInterval(uint8_t hub)
+{
+  return pollers[hub].pollInterval;
+}
@@ -0,0 +1,60 @@
+#include "log.h"
+#include <atomic>
+#include <stdarg.h>
+
+static char logBuffer[LOG_BUFFER_SIZE];
+
+// Total bytes ever written; writers reserve their range with one atomic add
+static std::atomic<uint32_t> logHead(0);
+
+static const char logLevelTags[] = "-EWIDV";
+
+void logWrite(uint8_t level, const char *format, ...)
+{
+  char line[LOG_LINE_MAX];
+  int length = snprintf(line, sizeof(line), "[%lu] %c ", millis(), logLevelTags[level]);
+
+  va_list args;
+  va_start(args, format);
+  int written = vsnprintf(line + length, sizeof(line) - length - 1, format, args);
+  va_end(args);
+
+  // vsnprintf reports the untruncated length
+  length += written < 0 ? 0 : min(written, (int)(sizeof(line) - length - 2));
+  line[length++] = '\n';
+
+  uint32_t start = logHead.fetch_add(length, std::memory_order_relaxed);
+  for (int i = 0; i < length; i++)
+    logBuffer[(start + i) & (LOG_BUFFER_SIZE - 1)] = line[i];
+
+  if (level <= BRIDGE_LOG_SERIAL_LEVEL)
+    Serial.write((const uint8_t *)line, length);
+}
+
+size_t logSegments(const char *&first, size_t &firstLength, const char *&second, size_t &secondLength)
+{
+  uint32_t head = logHead.load(std::memory_order_relaxed);
+  uint32_t start = head > LOG_BUFFER_SIZE ? head - LOG_BUFFER_SIZE : 0;
+
+  // Once the buffer has wrapped, skip the partly overwritten oldest line
+  if (start > 0)
+  {
+    while (start < head && logBuffer[start & (LOG_BUFFER_SIZE - 1)] != '\n')
+      start++;
+    start++;
+  }
+  if (start >= head)
+  {
+    firstLength = secondLength = 0;
+    first = second = logBuffer;
+    return 0;
+  }
+
+  uint32_t offset = start & (LOG_BUFFER_SIZE - 1);
+  size_t total = head - start;
+  first = logBuffer + offset;
+  firstLength = min(total, (size_t)(LOG_BUFFER_SIZE - offset));
+  second = logBuffer;
+  secondLength = total - firstLength;
+  return total;
+}
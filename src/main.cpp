@@ -2,8 +2,18 @@
 #include "globals.h"
 #include "config.h"
 #include "websockets.h"
-#include "webserver.h"
+#include "server.h"
 #include "network.h"
+#include "command_tracker.h"
+#include "websockets_commands.h"
+#include "deferred_response.h"
+#include "event_stream.h"
+#include "live_data_poller.h"
+#include "hub_task.h"
+#include "json_arena.h"
+#include "zone_commands.h"
+#include "zone_discovery.h"
+#include "zone_history.h"
 
 void setup()
 {
@@ -19,8 +29,17 @@ void setup()
   }
   else
   {
-    connectToNetwork();
-    setupWebSocket();
+    // Reserve the JSON arenas and history pool before the heap has a chance to fragment
+    reserveJsonArenas(getHubCount());
+    reserveZoneHistory();
+
+    // Zone routes answer from the saved catalog until the hub replies
+    loadZoneCatalog();
+
+    // Serve HTTP straight away; the network comes up from loop()
+    beginNetwork();
+    setupWebSockets();
+    startHubTasks();
     setupHttpServer();
   }
 }
@@ -40,8 +59,15 @@ void loop()
   }
   else
   {
-
-    webSocket.loop();
+    serviceNetwork();
+    serviceHubEvents();
+    serviceZoneDiscovery();
+    servicePoller();
+    serviceZoneCommands();
+    expireCommands();
     server.handleClient();
+    serviceDeferredResponses();
+    serviceEventStreams();
+    serviceZoneCatalog();
   }
 }
\ No newline at end of file
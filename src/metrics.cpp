@@ -0,0 +1,283 @@
+#include "metrics.h"
+#include <stdarg.h>
+#include "temperature_cache.h"
+#include "live_data_poller.h"
+#include "json_arena.h"
+#include "zone_history.h"
+#include "hub_task.h"
+#include "config.h"
+#include "globals.h"
+
+#define COMMAND_TYPE_COUNT 4
+
+// Bucket bounds in microseconds
+static const uint32_t handlerBounds[] = {100, 250, 500, 1000, 2500, 5000, 10000, 50000, 250000, 1000000};
+static const uint32_t roundTripBounds[] = {10000, 25000, 50000, 100000, 250000, 500000, 1000000, 2000000, 5000000};
+static const uint32_t parseBounds[] = {100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000};
+static const uint32_t connectBounds[] = {10000, 50000, 100000, 250000, 500000, 1000000, 2000000, 5000000, 10000000};
+
+static Histogram httpLatency[ROUTE_COUNT];
+static Histogram commandRoundTrip[COMMAND_TYPE_COUNT];
+static uint32_t commandTimeouts[COMMAND_TYPE_COUNT];
+static Histogram liveDataParse;
+static Histogram hubConnect[MAX_HUBS][3]; // Failed, full handshake, resumed session
+static uint32_t tlsSessionOffers[MAX_HUBS][2]; // Rejected, resumed
+static uint32_t webSocketConnects[MAX_HUBS];
+static uint32_t webSocketDisconnects[MAX_HUBS];
+static uint32_t webSocketErrors[MAX_HUBS];
+static unsigned long bootMilestones[BOOT_MILESTONE_COUNT]; // millis() + 1, 0 until reached
+
+static const char *const routeNames[ROUTE_COUNT] = {
+    "get_temp", "get_temp_deferred", "zone_state", "history", "set_temp", "standby", "zones",
+    "cache", "debug_log", "metrics", "not_found"};
+static const char *const commandNames[COMMAND_TYPE_COUNT] = {
+    "GET_ZONES", "GET_LIVE_DATA", "SET_TEMP", "FROST"};
+static const char *const milestoneNames[BOOT_MILESTONE_COUNT] = {
+    "wifi_connected", "hub_connected", "first_http_ok"};
+
+void observeHistogram(Histogram &histogram, uint32_t value)
+{
+  uint8_t bucket = 0;
+  while (bucket < histogram.boundCount && value > histogram.bounds[bucket])
+    bucket++;
+  histogram.counts[bucket]++;
+  histogram.samples++;
+  histogram.sum += value;
+}
+
+// Histograms pick up their bucket bounds on first use
+static Histogram &withBounds(Histogram &histogram, const uint32_t *bounds, size_t boundCount)
+{
+  if (!histogram.bounds)
+  {
+    histogram.bounds = bounds;
+    histogram.boundCount = boundCount;
+  }
+  return histogram;
+}
+
+#define BOUNDS(array) array, sizeof(array) / sizeof(array[0])
+
+void recordHttpLatency(HttpRoute route, uint32_t micros)
+{
+  observeHistogram(withBounds(httpLatency[route], BOUNDS(handlerBounds)), micros);
+}
+
+void recordCommandRoundTrip(CommandType type, uint32_t micros)
+{
+  if (type < COMMAND_TYPE_COUNT)
+    observeHistogram(withBounds(commandRoundTrip[type], BOUNDS(roundTripBounds)), micros);
+}
+
+void recordCommandTimeout(CommandType type)
+{
+  if (type < COMMAND_TYPE_COUNT)
+    commandTimeouts[type]++;
+}
+
+void recordLiveDataParse(uint32_t micros)
+{
+  observeHistogram(withBounds(liveDataParse, BOUNDS(parseBounds)), micros);
+}
+
+void recordHubConnect(uint8_t hub, uint32_t micros, bool connected, bool resumed)
+{
+  if (hub < MAX_HUBS)
+    observeHistogram(withBounds(hubConnect[hub][connected ? 1 + resumed : 0], BOUNDS(connectBounds)), micros);
+}
+
+void recordTlsSessionOffer(uint8_t hub, bool resumed)
+{
+  if (hub < MAX_HUBS)
+    tlsSessionOffers[hub][resumed]++;
+}
+
+void recordWebSocketConnected(uint8_t hub)
+{
+  if (hub < MAX_HUBS)
+    webSocketConnects[hub]++;
+}
+
+void recordWebSocketDisconnected(uint8_t hub)
+{
+  if (hub < MAX_HUBS)
+    webSocketDisconnects[hub]++;
+}
+
+void recordWebSocketError(uint8_t hub)
+{
+  if (hub < MAX_HUBS)
+    webSocketErrors[hub]++;
+}
+
+void recordBootMilestone(BootMilestone milestone)
+{
+  if (!bootMilestones[milestone])
+    bootMilestones[milestone] = millis() + 1;
+}
+
+#define METRICS_CHUNK_SIZE 512
+#define METRICS_LINE_MAX 160
+
+// Lines collect in one buffer and go out as a chunk when it is nearly full,
+// so a scrape costs a few dozen socket writes instead of one per line
+static char metricsChunk[METRICS_CHUNK_SIZE];
+static size_t metricsLength = 0;
+
+static void flushMetrics()
+{
+  if (metricsLength)
+    server.sendContent(metricsChunk, metricsLength);
+  metricsLength = 0;
+}
+
+static void sendMetricLine(const char *format, ...) __attribute__((format(printf, 1, 2)));
+static void sendMetricLine(const char *format, ...)
+{
+  if (METRICS_CHUNK_SIZE - metricsLength < METRICS_LINE_MAX)
+    flushMetrics();
+
+  va_list args;
+  va_start(args, format);
+  int written = vsnprintf(metricsChunk + metricsLength, METRICS_LINE_MAX, format, args);
+  va_end(args);
+  if (written > 0)
+    metricsLength += min(written, METRICS_LINE_MAX - 1);
+}
+
+// labels is the preformatted label list, e.g. route="zones"
+static void sendHistogram(const char *name, const char *labels, const Histogram &histogram)
+{
+  if (!histogram.bounds)
+    return;
+
+  uint32_t cumulative = 0;
+  for (uint8_t i = 0; i < histogram.boundCount; i++)
+  {
+    cumulative += histogram.counts[i];
+    sendMetricLine("%s_bucket{%s,le=\"%g\"} %lu\n", name, labels, histogram.bounds[i] / 1e6,
+                   (unsigned long)cumulative);
+  }
+  sendMetricLine("%s_bucket{%s,le=\"+Inf\"} %lu\n", name, labels, (unsigned long)histogram.samples);
+  sendMetricLine("%s_sum{%s} %.6f\n", name, labels, histogram.sum / 1e6);
+  sendMetricLine("%s_count{%s} %lu\n", name, labels, (unsigned long)histogram.samples);
+}
+
+void handleMetrics()
+{
+  RouteTimer timer(ROUTE_METRICS);
+
+  server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+  server.send(200, "text/plain; version=0.0.4", "");
+  metricsLength = 0;
+
+  char labels[48];
+  sendMetricLine("# TYPE bridge_http_handler_seconds histogram\n");
+  for (uint8_t route = 0; route < ROUTE_COUNT; route++)
+  {
+    snprintf(labels, sizeof(labels), "route=\"%s\"", routeNames[route]);
+    sendHistogram("bridge_http_handler_seconds", labels, httpLatency[route]);
+  }
+
+  sendMetricLine("# TYPE bridge_hub_round_trip_seconds histogram\n");
+  for (uint8_t type = 0; type < COMMAND_TYPE_COUNT; type++)
+  {
+    snprintf(labels, sizeof(labels), "command=\"%s\"", commandNames[type]);
+    sendHistogram("bridge_hub_round_trip_seconds", labels, commandRoundTrip[type]);
+  }
+
+  sendMetricLine("# TYPE bridge_hub_command_timeouts_total counter\n");
+  for (uint8_t type = 0; type < COMMAND_TYPE_COUNT; type++)
+    sendMetricLine("bridge_hub_command_timeouts_total{command=\"%s\"} %lu\n", commandNames[type],
+                   (unsigned long)commandTimeouts[type]);
+
+  sendMetricLine("# TYPE bridge_live_data_parse_seconds histogram\n");
+  sendHistogram("bridge_live_data_parse_seconds", "command=\"GET_LIVE_DATA\"", liveDataParse);
+
+  // Failed attempts often end early or hit a timeout, so they get their own
+  // series; "connected" ran a full TLS handshake, "resumed" reused a session
+  sendMetricLine("# TYPE bridge_hub_connect_seconds histogram\n");
+  for (uint8_t hub = 0; hub < getHubCount(); hub++)
+  {
+    snprintf(labels, sizeof(labels), "hub=\"%u\",outcome=\"connected\"", (unsigned)hub + 1);
+    sendHistogram("bridge_hub_connect_seconds", labels, hubConnect[hub][1]);
+    snprintf(labels, sizeof(labels), "hub=\"%u\",outcome=\"resumed\"", (unsigned)hub + 1);
+    sendHistogram("bridge_hub_connect_seconds", labels, hubConnect[hub][2]);
+    snprintf(labels, sizeof(labels), "hub=\"%u\",outcome=\"failed\"", (unsigned)hub + 1);
+    sendHistogram("bridge_hub_connect_seconds", labels, hubConnect[hub][0]);
+  }
+
+  // Resumption hit rate: resumed / (resumed + rejected)
+  sendMetricLine("# TYPE bridge_tls_session_offers_total counter\n");
+  for (uint8_t hub = 0; hub < getHubCount(); hub++)
+  {
+    sendMetricLine("bridge_tls_session_offers_total{hub=\"%u\",result=\"resumed\"} %lu\n", (unsigned)hub + 1,
+                   (unsigned long)tlsSessionOffers[hub][1]);
+    sendMetricLine("bridge_tls_session_offers_total{hub=\"%u\",result=\"rejected\"} %lu\n", (unsigned)hub + 1,
+                   (unsigned long)tlsSessionOffers[hub][0]);
+  }
+
+  const TemperatureCacheStats &cache = getTemperatureCacheStats();
+  sendMetricLine("# TYPE bridge_cache_lookups_total counter\n");
+  sendMetricLine("bridge_cache_lookups_total{result=\"fresh\"} %lu\n", (unsigned long)cache.freshHits);
+  sendMetricLine("bridge_cache_lookups_total{result=\"stale\"} %lu\n", (unsigned long)cache.staleHits);
+  sendMetricLine("bridge_cache_lookups_total{result=\"miss\"} %lu\n", (unsigned long)cache.misses);
+  sendMetricLine("# TYPE bridge_upstream_fetches_total counter\n");
+  sendMetricLine("bridge_upstream_fetches_total{kind=\"sent\"} %lu\n", (unsigned long)cache.upstreamFetches);
+  sendMetricLine("bridge_upstream_fetches_total{kind=\"coalesced\"} %lu\n", (unsigned long)cache.coalescedFetches);
+
+  sendMetricLine("# TYPE bridge_poll_interval_seconds gauge\n");
+  for (uint8_t hub = 0; hub < getHubCount(); hub++)
+    sendMetricLine("bridge_poll_interval_seconds{hub=\"%u\"} %.3f\n", (unsigned)hub + 1, getPollInterval(hub) / 1e3);
+  sendMetricLine("# TYPE bridge_hub_connected gauge\n");
+  for (uint8_t hub = 0; hub < getHubCount(); hub++)
+    sendMetricLine("bridge_hub_connected{hub=\"%u\"} %d\n", (unsigned)hub + 1, isHubConnected(hub) ? 1 : 0);
+
+  sendMetricLine("# TYPE bridge_websocket_events_total counter\n");
+  for (uint8_t hub = 0; hub < getHubCount(); hub++)
+  {
+    sendMetricLine("bridge_websocket_events_total{hub=\"%u\",event=\"connected\"} %lu\n", (unsigned)hub + 1,
+                   (unsigned long)webSocketConnects[hub]);
+    sendMetricLine("bridge_websocket_events_total{hub=\"%u\",event=\"disconnected\"} %lu\n", (unsigned)hub + 1,
+                   (unsigned long)webSocketDisconnects[hub]);
+    sendMetricLine("bridge_websocket_events_total{hub=\"%u\",event=\"error\"} %lu\n", (unsigned)hub + 1,
+                   (unsigned long)webSocketErrors[hub]);
+  }
+  // Every connect after a hub's first one is a reconnect
+  sendMetricLine("# TYPE bridge_websocket_reconnects_total counter\n");
+  for (uint8_t hub = 0; hub < getHubCount(); hub++)
+    sendMetricLine("bridge_websocket_reconnects_total{hub=\"%u\"} %lu\n", (unsigned)hub + 1,
+                   (unsigned long)(webSocketConnects[hub] > 0 ? webSocketConnects[hub] - 1 : 0));
+
+  sendMetricLine("# TYPE bridge_boot_milestone_seconds gauge\n");
+  for (uint8_t milestone = 0; milestone < BOOT_MILESTONE_COUNT; milestone++)
+  {
+    if (bootMilestones[milestone])
+      sendMetricLine("bridge_boot_milestone_seconds{milestone=\"%s\"} %.3f\n", milestoneNames[milestone],
+                     (bootMilestones[milestone] - 1) / 1e3);
+  }
+
+  sendMetricLine("# TYPE bridge_heap_free_bytes gauge\n");
+  sendMetricLine("bridge_heap_free_bytes %u\n", (unsigned)ESP.getFreeHeap());
+  sendMetricLine("# TYPE bridge_heap_min_free_bytes gauge\n");
+  sendMetricLine("bridge_heap_min_free_bytes %u\n", (unsigned)ESP.getMinFreeHeap());
+  sendMetricLine("# TYPE bridge_heap_largest_free_block_bytes gauge\n");
+  sendMetricLine("bridge_heap_largest_free_block_bytes %u\n", (unsigned)ESP.getMaxAllocHeap());
+  sendMetricLine("# TYPE bridge_json_arena_peak_bytes gauge\n");
+  for (uint8_t hub = 0; hub < getHubCount(); hub++)
+    sendMetricLine("bridge_json_arena_peak_bytes{arena=\"hub%u\"} %u\n", (unsigned)hub + 1, (unsigned)getHubJsonArena(hub).getPeak());
+  sendMetricLine("bridge_json_arena_peak_bytes{arena=\"http\"} %u\n", (unsigned)httpJsonArena.getPeak());
+  sendMetricLine("# TYPE bridge_json_arena_capacity_bytes gauge\n");
+  for (uint8_t hub = 0; hub < getHubCount(); hub++)
+    sendMetricLine("bridge_json_arena_capacity_bytes{arena=\"hub%u\"} %u\n", (unsigned)hub + 1, (unsigned)getHubJsonArena(hub).getCapacity());
+  sendMetricLine("bridge_json_arena_capacity_bytes{arena=\"http\"} %u\n", (unsigned)httpJsonArena.getCapacity());
+  sendMetricLine("# TYPE bridge_history_bytes gauge\n");
+  sendMetricLine("bridge_history_bytes %u\n", (unsigned)getZoneHistoryMemory());
+  sendMetricLine("# TYPE bridge_history_allocation_failures_total counter\n");
+  sendMetricLine("bridge_history_allocation_failures_total %lu\n", (unsigned long)getZoneHistoryAllocationFailures());
+  sendMetricLine("# TYPE bridge_uptime_seconds gauge\n");
+  sendMetricLine("bridge_uptime_seconds %lu\n", millis() / 1000);
+
+  flushMetrics();
+  server.sendContent("");
+}
@@ -1,40 +1,163 @@
-#include "websockets.h"
-#include "webserver.h"
 #include "config.h"
+#include "metrics.h"
+#include "log.h"
 #include "globals.h"
 #include "network.h"
 
-void connectToNetwork()
+#define NETWORK_CACHE_MAGIC 0x4E455431UL // "NET1"
+
+// Last access point we joined. Lives in RTC memory so it survives a software
+// restart and lets the next join skip the scan.
+struct NetworkCache
 {
-  WiFi.mode(WIFI_STA);
+  uint32_t magic;
+  uint8_t bssid[6];
+  int32_t channel;
+};
 
-  // Set hostname for easy identification
-  WiFi.setHostname(DEVICE_HOSTNAME);
+RTC_NOINIT_ATTR static NetworkCache networkCache;
+
+static NetworkState networkState = NETWORK_IDLE;
+static unsigned long stateChangedAt = 0;
+static unsigned long backoff = NETWORK_BACKOFF_MIN;
+static bool usingCache = false;
+static bool everConnected = false;
 
-  WiFi.begin(config.wifi_ssid, config.wifi_password);
+static void enterState(NetworkState state)
+{
+  networkState = state;
+  stateChangedAt = millis();
+}
+
+static void applyStaticAddress()
+{
+#ifdef NETWORK_STATIC_IP
+  IPAddress ip, gateway, subnet, dns;
+  ip.fromString(NETWORK_STATIC_IP);
+  gateway.fromString(NETWORK_GATEWAY);
+  subnet.fromString(NETWORK_SUBNET);
+#ifdef NETWORK_DNS
+  dns.fromString(NETWORK_DNS);
+#else
+  dns = gateway;
+#endif
+  if (!WiFi.config(ip, gateway, subnet, dns))
+    LOG_WARN("Static IP configuration failed, falling back to DHCP");
+#endif
+}
 
-  int attempts = 0;
-  while (WiFi.status() != WL_CONNECTED && attempts < 20)
+static void startJoin()
+{
+  usingCache = networkCache.magic == NETWORK_CACHE_MAGIC;
+  if (usingCache)
+  {
+    LOG_INFO("Joining %s on channel %ld (cached access point)", config.wifi_ssid, (long)networkCache.channel);
+    WiFi.begin(config.wifi_ssid, config.wifi_password, networkCache.channel, networkCache.bssid);
+  }
+  else
   {
-    delay(500);
-    Serial.print(".");
-    attempts++;
+    LOG_INFO("Joining %s", config.wifi_ssid);
+    WiFi.begin(config.wifi_ssid, config.wifi_password);
   }
+  enterState(NETWORK_CONNECTING);
+}
+
+static void onConnected()
+{
+  networkCache.magic = NETWORK_CACHE_MAGIC;
+  memcpy(networkCache.bssid, WiFi.BSSID(), sizeof(networkCache.bssid));
+  networkCache.channel = WiFi.channel();
+
+  LOG_INFO("Connected to WiFi in %lu ms", millis() - stateChangedAt);
+  LOG_INFO("IP address: %s", WiFi.localIP().toString().c_str());
+  LOG_INFO("Hostname: %s", WiFi.getHostname());
 
-  if (WiFi.status() == WL_CONNECTED)
+  // SNTP keeps the clock in sync from here on
+  if (!everConnected)
+    configTime(0, 0, NETWORK_NTP_SERVER);
+
+  everConnected = true;
+  backoff = NETWORK_BACKOFF_MIN;
+  recordBootMilestone(BOOT_WIFI_CONNECTED);
+  enterState(NETWORK_CONNECTED);
+}
+
+static void onJoinFailed()
+{
+  WiFi.disconnect();
+
+  // The access point may have moved; retry straight away with a full scan
+  if (usingCache)
   {
-    isConfigMode = false;
-    Serial.println("\nConnected to WiFi");
-    Serial.print("IP address: ");
-    Serial.println(WiFi.localIP());
-    Serial.print("Hostname: ");
-    Serial.println(WiFi.getHostname());
-
-    setupWebSocket();
-    setupHttpServer();
+    LOG_WARN("Cached access point unreachable, scanning");
+    networkCache.magic = 0;
+    startJoin();
+    return;
   }
-  else
+
+  // Never reached the network since boot: the credentials may be wrong
+  if (!everConnected)
   {
-    startConfigMode(); // Fall back to config mode if connection fails
+    LOG_WARN("WiFi connection failed, starting configuration mode");
+    enterState(NETWORK_IDLE);
+    isConfigMode = true;
+    startConfigMode();
+    return;
   }
-}
\ No newline at end of file
+
+  LOG_WARN("WiFi connection failed, retrying in %lu ms", backoff);
+  enterState(NETWORK_BACKOFF);
+}
+
+void beginNetwork()
+{
+  WiFi.mode(WIFI_STA);
+
+  // Set hostname for easy identification
+  WiFi.setHostname(DEVICE_HOSTNAME);
+
+  // Reconnects are driven by serviceNetwork() with backoff
+  WiFi.setAutoReconnect(false);
+  applyStaticAddress();
+
+  isConfigMode = false;
+  startJoin();
+}
+
+void serviceNetwork()
+{
+  switch (networkState)
+  {
+  case NETWORK_IDLE:
+    break;
+
+  case NETWORK_CONNECTING:
+    if (WiFi.status() == WL_CONNECTED)
+      onConnected();
+    else if (millis() - stateChangedAt > NETWORK_CONNECT_TIMEOUT)
+      onJoinFailed();
+    break;
+
+  case NETWORK_CONNECTED:
+    if (WiFi.status() != WL_CONNECTED)
+    {
+      LOG_WARN("WiFi connection lost, rejoining in %lu ms", backoff);
+      WiFi.disconnect();
+      enterState(NETWORK_BACKOFF);
+    }
+    break;
+
+  case NETWORK_BACKOFF:
+    if (millis() - stateChangedAt >= backoff)
+    {
+      backoff = min(backoff * 2, (unsigned long)NETWORK_BACKOFF_MAX);
+      startJoin();
+    }
+    break;
+  }
+}
+
+bool isNetworkConnected()
+{
+  return networkState == NETWORK_CONNECTED;
+}
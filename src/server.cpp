@@ -1,10 +1,141 @@
+#include <ArduinoJson.h>
+#include "log.h"
 #include "globals.h"
+#include "temperature_cache.h"
+#include "live_data_poller.h"
+#include "zone_table.h"
+#include "zone_routes.h"
+#include "metrics.h"
+#include "event_stream.h"
+#include "json_arena.h"
+
+// Snapshot of every cached zone. The ETag follows the catalog and state
+// generations, so a poll with a matching If-None-Match costs a 304 instead of
+// a body build, and added, renamed or removed zones still change it.
+void handleZones()
+{
+  RouteTimer timer(ROUTE_ZONES);
+  static uint32_t bootNonce = esp_random();
+  String etag = "\"" + String(bootNonce, HEX) + "-" + String(getZoneCatalogGeneration(), HEX) + "-" +
+                String(getZoneStateGeneration(), HEX) + "\"";
+
+  // Revalidate in the background every hub that has anything stale
+  unsigned long now = millis();
+  ZoneState state;
+  uint32_t staleHubs = 0;
+  for (int zoneId = 0; zoneId < getZoneCount(); zoneId++)
+  {
+    uint8_t hub = getZoneHub(zoneId);
+    if (getZoneState(zoneId, state) && now - state.updatedAt > getHubCacheTtl(hub))
+      staleHubs |= 1UL << hub;
+  }
+  for (uint8_t hub = 0; staleHubs; hub++, staleHubs >>= 1)
+  {
+    if (staleHubs & 1)
+      refreshLiveData(hub);
+  }
+
+  server.sendHeader("ETag", etag);
+  server.sendHeader("Cache-Control", "no-cache");
+
+  if (server.header("If-None-Match") == etag)
+  {
+    server.send(304);
+    return;
+  }
+
+  // Zone names are referenced in place; the document, the formatted
+  // temperatures and the body all come from the HTTP arena
+  ArenaScope scope(httpJsonArena);
+  int zoneCount = getZoneCount();
+  ArenaJsonDocument doc(JSON_OBJECT_SIZE(1) + JSON_ARRAY_SIZE(zoneCount) + zoneCount * JSON_OBJECT_SIZE(2),
+                        ArenaAllocator(httpJsonArena));
+  JsonArray zones = doc.createNestedArray("zones");
+  bool complete = true;
+  for (int zoneId = 0; zoneId < zoneCount; zoneId++)
+  {
+    if (!getZoneState(zoneId, state))
+      continue;
+
+    char *text = (char *)httpJsonArena.allocate(8);
+    if (!text)
+    {
+      complete = false;
+      break;
+    }
+    snprintf(text, 8, "%.1f", state.actualTemp);
+
+    JsonObject zone = zones.createNestedObject();
+    zone["zone"] = getZoneName(zoneId);
+    zone["temperature"] = serialized((const char *)text);
+  }
+
+  size_t length = measureJson(doc);
+  char *body = (char *)httpJsonArena.allocate(length + 1);
+  if (!complete || doc.overflowed() || !body)
+  {
+    LOG_ERROR("HTTP arena too small for /zones");
+    server.send(500, "text/plain", "Out of memory");
+    return;
+  }
+
+  serializeJson(doc, body, length + 1);
+  server.send_P(200, "application/json", body, length);
+}
+
+// Streams the in-RAM log straight out of the ring buffer
+void handleDebugLog()
+{
+  RouteTimer timer(ROUTE_DEBUG_LOG);
+  const char *first;
+  const char *second;
+  size_t firstLength;
+  size_t secondLength;
+  size_t total = logSegments(first, firstLength, second, secondLength);
+
+  server.setContentLength(total);
+  server.send(200, "text/plain", "");
+  if (firstLength)
+    server.sendContent(first, firstLength);
+  if (secondLength)
+    server.sendContent(second, secondLength);
+}
+
+// POST /cache_ttl?ms=10000. Shorter than the fastest poll would only add
+// upstream fetches; longer than the maximum age would never be fresh.
+static void handleSetCacheTtl()
+{
+  RouteTimer timer(ROUTE_CACHE);
+  String value = server.arg("ms");
+  char *end = nullptr;
+  long ttl = strtol(value.c_str(), &end, 10);
+  if (value.length() == 0 || *end != '\0' || ttl < POLL_INTERVAL_MIN || ttl > TEMPERATURE_CACHE_MAX_AGE)
+  {
+    server.send(400, "text/plain",
+                "ms must be a whole number from " + String(POLL_INTERVAL_MIN) + " to " + String(TEMPERATURE_CACHE_MAX_AGE));
+    return;
+  }
+
+  setTemperatureCacheTtl(ttl);
+  server.send(200, "text/plain", "Cache TTL: " + String(getTemperatureCacheTtl()) + " ms");
+}
 
 void setupHttpServer()
 {
+  // Headers the handlers need to read
+  const char *headerKeys[] = {"If-None-Match"};
+  server.collectHeaders(headerKeys, sizeof(headerKeys) / sizeof(headerKeys[0]));
+
+  server.on("/zones", HTTP_GET, handleZones);
+  server.on("/debug/log", HTTP_GET, handleDebugLog);
+  server.on("/metrics", HTTP_GET, handleMetrics);
+  server.on("/events", HTTP_GET, handleEventSubscribe);
+  setupZoneRoutes();
+
   // Debug handler for all requests
   server.onNotFound([]()
                     {
+    RouteTimer timer(ROUTE_NOT_FOUND);
     String message = "No handler found\n";
     message += "URI: " + server.uri() + "\n";
     message += "Method: " + String((server.method() == HTTP_GET) ? "GET" : "POST") + "\n";
@@ -14,9 +145,34 @@ void setupHttpServer()
       message += " " + server.argName(i) + ": " + server.arg(i) + "\n";
     }
     
-    Serial.println(message);
+    LOG_DEBUG("%s", message.c_str());
     server.send(404, "text/plain", message); });
 
+  // Cache effectiveness: every hit and coalesced read is an upstream fetch saved
+  server.on("/cache_stats", HTTP_GET, []()
+            {
+    RouteTimer timer(ROUTE_CACHE);
+    const TemperatureCacheStats &stats = getTemperatureCacheStats();
+    uint32_t requests = stats.freshHits + stats.staleHits + stats.misses;
+    uint32_t saved = requests > stats.upstreamFetches ? requests - stats.upstreamFetches : 0;
+
+    String response = "{\"ttl_ms\":" + String(getTemperatureCacheTtl());
+    response += ",\"fresh_hits\":" + String(stats.freshHits);
+    response += ",\"stale_hits\":" + String(stats.staleHits);
+    response += ",\"misses\":" + String(stats.misses);
+    response += ",\"upstream_fetches\":" + String(stats.upstreamFetches);
+    response += ",\"coalesced_fetches\":" + String(stats.coalescedFetches);
+    response += ",\"fetches_saved\":" + String(saved) + "}";
+    server.send(200, "application/json", response); });
+
+  // Read the freshness TTL; POST changes it at runtime
+  server.on("/cache_ttl", HTTP_GET, []()
+            {
+    RouteTimer timer(ROUTE_CACHE);
+    server.send(200, "text/plain", "Cache TTL: " + String(getTemperatureCacheTtl()) + " ms"); });
+
+  server.on("/cache_ttl", HTTP_POST, handleSetCacheTtl);
+
   server.begin();
-  Serial.println("HTTP server started");
+  LOG_INFO("HTTP server started");
 }
\ No newline at end of file
@@ -0,0 +1,162 @@
+#include "temperature_cache.h"
+#include "websockets_commands.h"
+#include "event_stream.h"
+#include "zone_history.h"
+#include "globals.h"
+
+static unsigned long cacheTtl = TEMPERATURE_CACHE_TTL;
+static TemperatureCacheStats cacheStats;
+static uint32_t zoneStateGeneration = 0;
+
+// The GET_LIVE_DATA request in flight to one hub and the callers joined to it
+struct LiveDataRefresh
+{
+  uint32_t commandId;
+  CommandCallback waiters[MAX_LIVE_DATA_WAITERS];
+  uint8_t waiterCount;
+  unsigned long refreshInterval;
+  uint32_t stateGeneration;
+};
+static LiveDataRefresh refreshes[MAX_HUBS];
+
+void setTemperatureCacheTtl(unsigned long ttl)
+{
+  cacheTtl = ttl;
+}
+
+unsigned long getTemperatureCacheTtl()
+{
+  return cacheTtl;
+}
+
+unsigned long getHubCacheTtl(uint8_t hub)
+{
+  return max(cacheTtl, refreshes[hub].refreshInterval);
+}
+
+void setRefreshInterval(uint8_t hub, unsigned long interval)
+{
+  refreshes[hub].refreshInterval = interval;
+}
+
+CacheResult lookupZoneState(int zoneId, ZoneState &state)
+{
+  bool known = getZoneState(zoneId, state);
+  unsigned long age = known ? millis() - state.updatedAt : 0;
+
+  if (!known || age > TEMPERATURE_CACHE_MAX_AGE)
+  {
+    cacheStats.misses++;
+    return CACHE_MISS;
+  }
+
+  if (age <= getHubCacheTtl(getZoneHub(zoneId)))
+  {
+    cacheStats.freshHits++;
+    return CACHE_FRESH;
+  }
+
+  cacheStats.staleHits++;
+  return CACHE_STALE;
+}
+
+bool storeZoneState(uint8_t hub, const char *localName, const ZoneState &state)
+{
+  // Only GET_ZONES adds zones, so renames are recognised by device number
+  int zoneId = findHubZone(hub, localName);
+  if (zoneId < 0)
+    return false;
+
+  ZoneState reported = state;
+  reported.flags |= ZONE_HAS_STATE;
+  bool changed = setZoneState(zoneId, reported);
+  recordZoneHistory(zoneId, esp_timer_get_time() / 1000000, state.actualTemp);
+
+  if (changed)
+  {
+    zoneStateGeneration++;
+    refreshes[hub].stateGeneration++;
+    publishZoneUpdate(getZoneName(zoneId), reported);
+  }
+  return true;
+}
+
+void updateZoneState(int zoneId, const ZoneState &state)
+{
+  if (setZoneState(zoneId, state))
+  {
+    zoneStateGeneration++;
+    refreshes[getZoneHub(zoneId)].stateGeneration++;
+    publishZoneUpdate(getZoneName(zoneId), state);
+  }
+}
+
+void restoreTemperature(int zoneId, float temperature)
+{
+  ZoneState state = {};
+  state.actualTemp = temperature;
+  state.flags = ZONE_HAS_READING;
+  state.updatedAt = millis() - getHubCacheTtl(getZoneHub(zoneId)) - 1;
+  setZoneState(zoneId, state);
+  zoneStateGeneration++;
+}
+
+static void notifyLiveDataWaiters(LiveDataRefresh &refresh, uint32_t commandId, CommandStatus status)
+{
+  // Waiters may start the next refresh, so empty the list before calling them
+  CommandCallback waiters[MAX_LIVE_DATA_WAITERS];
+  uint8_t count = refresh.waiterCount;
+  for (uint8_t i = 0; i < count; i++)
+  {
+    waiters[i] = refresh.waiters[i];
+    refresh.waiters[i] = nullptr;
+  }
+  refresh.waiterCount = 0;
+
+  for (uint8_t i = 0; i < count; i++)
+    waiters[i](commandId, status);
+}
+
+uint32_t refreshLiveData(uint8_t hub, CommandCallback onComplete)
+{
+  LiveDataRefresh &refresh = refreshes[hub];
+  bool joining = isCommandPending(refresh.commandId);
+
+  if (onComplete)
+  {
+    if (refresh.waiterCount >= MAX_LIVE_DATA_WAITERS)
+    {
+      onComplete(0, COMMAND_FAILED);
+      return 0;
+    }
+    refresh.waiters[refresh.waiterCount++] = onComplete;
+  }
+
+  if (joining)
+  {
+    cacheStats.coalescedFetches++;
+    return refresh.commandId;
+  }
+
+  cacheStats.upstreamFetches++;
+  refresh.commandId = sendGetTemperatureCommand(hub, [&refresh](uint32_t commandId, CommandStatus status)
+                                                { notifyLiveDataWaiters(refresh, commandId, status); });
+  if (!refresh.commandId)
+    notifyLiveDataWaiters(refresh, 0, COMMAND_FAILED);
+  return refresh.commandId;
+}
+
+const TemperatureCacheStats &getTemperatureCacheStats()
+{
+  return cacheStats;
+}
+
+uint32_t getZoneStateGeneration()
+{
+  return zoneStateGeneration;
+}
+
+uint32_t getHubStateGeneration(uint8_t hub)
+{
+  return refreshes[hub].stateGeneration;
+}
@@ -1,8 +1,25 @@
-#include <WebSocketsClient.h>
+#include <ResumableWebSocketsClient.h>
 #include <ArduinoJson.h>
+#include "websockets.h"
 #include "websockets_commands.h"
+#include "live_data_parser.h"
+#include "hub_task.h"
+#include "json_arena.h"
+#include "config.h"
+#include "log.h"
 #include "globals.h"
 
+// One client per configured hub, each only touched by that hub's task
+static ResumableWebSocketsClient hubSockets[MAX_HUBS];
+static bool longNameWarned[MAX_HUBS];
+static unsigned long pendingConnectTime[MAX_HUBS]; // Blocking time of an attempt not yet upgraded, 0 if none
+
+#if HEATMISER_USE_TLS
+// Each hub's last TLS session, offered again on reconnect. Lives in RTC memory
+// so the first connect after a software restart can resume too.
+RTC_NOINIT_ATTR static TlsSessionSlot hubTlsSessions[MAX_HUBS];
+#endif
+
 String urlEncode(const String &str)
 {
   String encodedString = "";
@@ -43,267 +60,299 @@ String urlEncode(const String &str)
   return encodedString;
 }
 
-void createHttpEndpoints(JsonObject zones)
+void registerZones(uint8_t hub, JsonObject zones)
 {
-  Serial.println("Creating HTTP endpoints for zones...");
+  LOG_DEBUG("Registering zones...");
 
   for (JsonPair kv : zones)
   {
-    String zoneName = kv.key().c_str();
-    if (zoneName == "result")
+    const char *zoneName = kv.key().c_str();
+    if (strcmp(zoneName, "result") == 0)
+      continue;
+
+    if (strlen(zoneName) >= MAX_ZONE_NAME)
+    {
+      LOG_WARN("Zone name too long, skipping: %s", zoneName);
       continue;
+    }
 
-    String encodedZoneName = urlEncode(zoneName);
-
-    // Create standby endpoints
-    String standbyOnPath = "/standby_on/" + encodedZoneName;
-    String standbyOffPath = "/standby_off/" + encodedZoneName;
-
-    // Register handlers with explicit paths
-    server.on(standbyOnPath.c_str(), HTTP_GET, [zoneName]()
-              {
-      Serial.println("Standby ON request for zone: " + zoneName);
-      sendStandbyCommand(zoneName, true);
-      server.send(200, "text/plain", "Standby ON sent for: " + zoneName); });
-
-    server.on(standbyOffPath.c_str(), HTTP_GET, [zoneName]()
-              {
-      Serial.println("Standby OFF request for zone: " + zoneName);
-      sendStandbyCommand(zoneName, false); 
-      server.send(200, "text/plain", "Standby OFF sent for: " + zoneName); });
-
-    // Add temperature endpoint
-    String setTempPath = "/set_temp/" + encodedZoneName;
-    server.on(setTempPath.c_str(), HTTP_GET, [zoneName]()
-              {
-      if(server.hasArg("temp")) {
-        float temp = server.arg("temp").toFloat();
-        Serial.println("Setting temperature for zone " + zoneName + " to " + String(temp));
-        sendSetTemperatureCommand(zoneName, temp);
-        server.send(200, "text/plain", "Temperature set to " + String(temp) + " for zone: " + zoneName);
-      } else {
-        server.send(400, "text/plain", "Missing temp parameter");
-      } });
-
-    Serial.println("Registered endpoint: " + setTempPath);
-
-    // Add temperature endpoint
-    String getTempPath = "/get_temp/" + encodedZoneName;
-    server.on(getTempPath.c_str(), HTTP_GET, [zoneName]()
-              {
-        auto it = temperatures.find(zoneName);
-        
-        // If we have a cached value, return it
-        if (it != temperatures.end()) {
-            String response = "{\"zone\":\"" + zoneName + 
-                             "\",\"temperature\":" + 
-                             String(it->second, 1) + "}";
-            server.send(200, "application/json", response);
-            
-            // Request fresh value in background
-            sendGetTemperatureCommand(zoneName);
-            return;
-        }
-        
-        // No cached value - request and wait
-        sendGetTemperatureCommand(zoneName);
-        lastTempRequest = millis();
-        
-        // Wait for response with timeout
-        while (millis() - lastTempRequest < TEMP_TIMEOUT) {
-            webSocket.loop(); // Keep WebSocket alive
-            delay(100);
-            
-            // Check if temperature arrived
-            it = temperatures.find(zoneName);
-            if (it != temperatures.end()) {
-                String response = "{\"zone\":\"" + zoneName + 
-                                "\",\"temperature\":" + 
-                                String(it->second, 1) + "}";
-                server.send(200, "application/json", response);
-                return;
-            }
-        }
-        
-        // Timeout reached
-        server.send(202, "text/plain", 
-            "Temperature request sent for zone: " + zoneName + 
-            ". Please try again in a few seconds."); });
-
-    Serial.println("Registered endpoint: " + getTempPath);
-
-    Serial.println("Registered endpoints:");
-    Serial.println(" - " + standbyOnPath);
-    Serial.println(" - " + standbyOffPath);
+    // The value is the hub's device number for the zone, which survives renames
+    postHubEvent(hub, HUB_EVENT_ZONE, kv.value().as<uint16_t>(), COMMAND_OK, zoneName);
+    LOG_INFO("Registered zone: %s on hub %u", zoneName, (unsigned)hub + 1);
   }
 
-  Serial.println("All HTTP endpoints created");
+  LOG_INFO("All zones registered");
 }
 
-void handleWebSocketMessage(uint8_t *payload, size_t length)
+// Everything below runs in the hub task; results reach the loop() core as hub events
+
+static void replyTo(uint8_t hub, uint32_t commandId, CommandStatus status)
 {
-  Serial.println("Parsing message...");
+  postHubEvent(hub, HUB_EVENT_REPLY, commandId, status);
+}
 
-  StaticJsonDocument<1024> doc;
-  DeserializationError error = deserializeJson(doc, payload, length);
+void updateZoneState(const LiveDeviceData &device, void *context)
+{
+  postHubReading((uint8_t)(uintptr_t)context, device);
+  LOG_VERBOSE("Zone %s: %.1f (set %.1f)", device.zoneName, device.actualTemp, device.setTemp);
+}
+
+void handleWebSocketMessage(uint8_t hub, uint8_t *payload, size_t length)
+{
+  LOG_VERBOSE("Parsing message...");
+
+  // Read the envelope only; the response body is parsed per command below.
+  // Passing a const pointer keeps ArduinoJson from unescaping the payload in place.
+  StaticJsonDocument<64> filter;
+  filter["message_type"] = true;
+  filter["command_id"] = true;
+
+  StaticJsonDocument<256> doc;
+  DeserializationError error = deserializeJson(
+      doc,
+      (const char *)payload,
+      length,
+      DeserializationOption::Filter(filter));
 
   if (error)
   {
-    Serial.print("deserializeJson() failed: ");
-    Serial.println(error.c_str());
+    LOG_ERROR("deserializeJson() failed: %s", error.c_str());
     return;
   }
 
-  String debugMsg;
-  serializeJson(doc, debugMsg);
-  Serial.println("Received JSON: " + debugMsg);
-
   const char *messageType = doc["message_type"];
-  if (messageType)
+  if (!messageType)
+    return;
+
+  LOG_DEBUG("Message type: %s", messageType);
+  if (strcmp(messageType, "hm_set_command_response") != 0)
+    return;
+
+  uint32_t commandId = doc["command_id"].as<uint32_t>();
+  LOG_DEBUG("Command ID: %lu", (unsigned long)commandId);
+
+  // Route the reply by the command that produced it
+  CommandType commandType;
+  if (!lookupSentCommand(hub, commandId, commandType))
   {
-    Serial.println("Message type: " + String(messageType));
+    LOG_WARN("Ignoring reply for unknown command ID %lu", (unsigned long)commandId);
+    return;
+  }
 
-    if (strcmp(messageType, "hm_set_command_response") == 0)
+  switch (commandType)
+  {
+  case CMD_GET_ZONES:
+  {
+    // Both documents live in the hub arena and reference strings inside the
+    // payload, which is unescaped in place; nothing here touches the heap
+    JsonArena &arena = getHubJsonArena(hub);
+    ArenaScope scope(arena);
+    ArenaJsonDocument zonesEnvelope(1024, ArenaAllocator(arena));
+    DeserializationError envelopeError = deserializeJson(zonesEnvelope, (char *)payload, length);
+    if (envelopeError)
     {
-      int commandId = doc["command_id"];
-      Serial.println("Command ID: " + String(commandId));
+      LOG_ERROR("deserializeJson() failed: %s", envelopeError.c_str());
+      replyTo(hub, commandId, COMMAND_FAILED);
+      return;
+    }
 
-      // Only create endpoints for GET_ZONES response (command_id 1)
-      if (commandId == 1)
-      {
-        String response = doc["response"];
-        Serial.println("Received zones response: " + response);
-
-        // Verify this is a zones list response by checking content
-        DynamicJsonDocument zoneDoc(1024);
-        DeserializationError zoneError = deserializeJson(zoneDoc, response.c_str());
-        if (zoneError)
-        {
-          Serial.print("deserializeJson() failed for zones: ");
-          Serial.println(zoneError.c_str());
-          return;
-        }
-
-        // Skip if response contains "result" instead of zones
-        if (zoneDoc.containsKey("result"))
-        {
-          Serial.println("Skipping endpoint creation - not a zones list");
-          return;
-        }
-
-        // Only create endpoints if not already created
-        if (!endpointsCreated)
-        {
-          createHttpEndpoints(zoneDoc.as<JsonObject>());
-          endpointsCreated = true;
-        }
-      }
-      // Handle GET_LIVE_DATA response (command_id 2)
-      else if (commandId == 2)
-      {
+    char *response = (char *)zonesEnvelope["response"].as<const char *>();
+    if (!response)
+    {
+      LOG_ERROR("Zones reply has no response");
+      replyTo(hub, commandId, COMMAND_FAILED);
+      return;
+    }
+    LOG_DEBUG("Received zones response: %s", response);
 
-        String response = doc["response"];
-        Serial.println("Free heap before parsing: " + String(ESP.getFreeHeap()));
-
-        // Create filter to only parse needed fields
-        StaticJsonDocument<128> filter;
-        filter["devices"][0]["ZONE_NAME"] = true;
-        filter["devices"][0]["ACTUAL_TEMP"] = true;
-
-        // Use larger buffer with filter
-        DynamicJsonDocument responseDoc(32768); // Increased buffer
-        DeserializationError responseError = deserializeJson(
-            responseDoc,
-            response,
-            DeserializationOption::Filter(filter));
-
-        if (responseError)
-        {
-          Serial.print("Failed to parse LIVE_DATA response: ");
-          Serial.println(responseError.c_str());
-          return;
-        }
-
-        JsonArray devices = responseDoc["devices"];
-        if (!devices.isNull())
-        {
-          for (JsonObject device : devices)
-          {
-            if (device.containsKey("ZONE_NAME") && device.containsKey("ACTUAL_TEMP"))
-            {
-              String zoneName = device["ZONE_NAME"].as<String>();
-              String tempStr = device["ACTUAL_TEMP"].as<String>();
-              temperatures[zoneName] = tempStr.toFloat();
-              Serial.println("Temperature for " + zoneName + ": " + tempStr);
-            }
-          }
-        }
-
-        Serial.println("Free heap after parsing: " + String(ESP.getFreeHeap()));
-      }
+    // Verify this is a zones list response by checking content
+    ArenaJsonDocument zoneDoc(1024, ArenaAllocator(arena));
+    DeserializationError zoneError = deserializeJson(zoneDoc, response);
+    if (zoneError)
+    {
+      LOG_ERROR("deserializeJson() failed for zones: %s", zoneError.c_str());
+      replyTo(hub, commandId, COMMAND_FAILED);
+      return;
     }
+
+    // Skip if response contains "result" instead of zones
+    if (zoneDoc.containsKey("result"))
+    {
+      LOG_DEBUG("Skipping zone registration - not a zones list");
+      replyTo(hub, commandId, COMMAND_FAILED);
+      return;
+    }
+
+    // The loop() core diffs the listed zones against the zone table
+    registerZones(hub, zoneDoc.as<JsonObject>());
+    replyTo(hub, commandId, COMMAND_OK);
+    break;
+  }
+
+  case CMD_GET_LIVE_DATA:
+  {
+    LOG_DEBUG("Free heap before parsing: %u", (unsigned)ESP.getFreeHeap());
+
+    // Stream the zone readings straight out of the payload
+    unsigned long parseStart = micros();
+    int skipped = 0;
+    int devices = parseLiveData(payload, length, updateZoneState, (void *)(uintptr_t)hub, &skipped);
+    postHubEvent(hub, HUB_EVENT_PARSE_TIME, micros() - parseStart);
+    if (devices < 0)
+    {
+      LOG_ERROR("Failed to parse LIVE_DATA response");
+      replyTo(hub, commandId, COMMAND_FAILED);
+      return;
+    }
+
+    // Polled every few seconds, so only the first time
+    if (skipped && !longNameWarned[hub])
+    {
+      LOG_WARN("Zone name too long, skipping %d device(s) on hub %u", skipped, (unsigned)hub + 1);
+      longNameWarned[hub] = true;
+    }
+
+    LOG_DEBUG("Free heap after parsing: %u (%d devices)", (unsigned)ESP.getFreeHeap(), devices);
+    replyTo(hub, commandId, COMMAND_OK);
+    break;
+  }
+
+  case CMD_SET_TEMP:
+  case CMD_FROST:
+  {
+    // The hub answers {"error": ...} in the response when it rejects a
+    // command; zone names elsewhere in the frame may say "error" too
+    JsonArena &arena = getHubJsonArena(hub);
+    ArenaScope scope(arena);
+    ArenaJsonDocument envelope(512, ArenaAllocator(arena));
+    DeserializationError envelopeError = deserializeJson(envelope, (char *)payload, length);
+    const char *response = envelopeError ? nullptr : envelope["response"].as<const char *>();
+    if (!response)
+    {
+      LOG_ERROR("Command reply has no response");
+      replyTo(hub, commandId, COMMAND_FAILED);
+      return;
+    }
+
+    ArenaJsonDocument result(256, ArenaAllocator(arena));
+    DeserializationError resultError = deserializeJson(result, (char *)response);
+    if (resultError)
+    {
+      LOG_ERROR("deserializeJson() failed for command response: %s", resultError.c_str());
+      replyTo(hub, commandId, COMMAND_FAILED);
+      return;
+    }
+
+    replyTo(hub, commandId, result.containsKey("error") ? COMMAND_FAILED : COMMAND_OK);
+    break;
+  }
   }
 }
 
-void webSocketEvent(WStype_t type, uint8_t *payload, size_t length)
+void webSocketEvent(uint8_t hub, WStype_t type, uint8_t *payload, size_t length)
 {
   switch (type)
   {
   case WStype_DISCONNECTED:
-    Serial.println("WebSocket Disconnected!");
+    LOG_WARN("WebSocket %u Disconnected!", (unsigned)hub + 1);
+    postHubEvent(hub, HUB_EVENT_DISCONNECTED);
     break;
 
   case WStype_CONNECTED:
-    Serial.println("WebSocket Connected!");
-    sendGetZonesCommand(); // Send GET_ZONES command when connected
+    LOG_INFO("WebSocket %u Connected!", (unsigned)hub + 1);
+    postHubEvent(hub, HUB_EVENT_CONNECTED);
     break;
 
   case WStype_TEXT:
-    Serial.println("Received message: " + String((char *)payload));
-    handleWebSocketMessage(payload, length);
+    LOG_VERBOSE("Received message: %.*s", (int)length, (const char *)payload);
+    handleWebSocketMessage(hub, payload, length);
     break;
 
   case WStype_ERROR:
-    Serial.println("WebSocket Error!");
-    if (payload)
-    {
-      Serial.println("Error payload: " + String((char *)payload));
-    }
+    LOG_ERROR("WebSocket %u Error: %.*s", (unsigned)hub + 1, payload ? (int)length : 0, payload ? (const char *)payload : "");
+    postHubEvent(hub, HUB_EVENT_ERROR);
     break;
 
   case WStype_BIN:
-    Serial.println("Received binary data");
+    LOG_DEBUG("Received binary data");
     break;
 
   case WStype_PING:
-    Serial.println("Received ping");
+    LOG_VERBOSE("Received ping");
     break;
 
   case WStype_PONG:
-    Serial.println("Received pong");
+    LOG_VERBOSE("Received pong");
     break;
 
   case WStype_FRAGMENT_TEXT_START:
   case WStype_FRAGMENT_BIN_START:
   case WStype_FRAGMENT:
   case WStype_FRAGMENT_FIN:
-    Serial.println("Received fragmented data");
+    LOG_DEBUG("Received fragmented data");
     break;
   }
 }
 
-void setupWebSocket()
+void setupWebSockets()
+{
+  for (uint8_t hub = 0; hub < getHubCount(); hub++)
+  {
+    const char *address = getHubAddress(hub);
+    LOG_INFO("Setting up WebSocket connection %u to %s:%d", (unsigned)hub + 1, address, HEATMISER_PORT);
+
+#if HEATMISER_USE_TLS
+    // Begin WebSocket connection with SSL
+    hubSockets[hub].beginSSL(address, HEATMISER_PORT, "/");
+    hubSockets[hub].setSessionSlot(&hubTlsSessions[hub]);
+#else
+    hubSockets[hub].begin(address, HEATMISER_PORT, "/");
+#endif
+
+    hubSockets[hub].onEvent([hub](WStype_t type, uint8_t *payload, size_t length)
+                            { webSocketEvent(hub, type, payload, length); });
+  }
+
+  LOG_DEBUG("WebSocket setup completed");
+}
+
+void serviceWebSocket(uint8_t hub)
 {
-  Serial.println("Setting up WebSocket connection...");
-  Serial.println("Heatmiser IP: " + String(config.heatmiser_ip));
-  Serial.println("Heatmiser Port: " + String(HEATMISER_PORT));
+  ResumableWebSocketsClient &socket = hubSockets[hub];
+  if (socket.isConnected())
+  {
+    socket.loop();
+    return;
+  }
 
-  // Begin WebSocket connection with SSL
-  webSocket.beginSSL(config.heatmiser_ip, HEATMISER_PORT, "/");
+  // While disconnected, the call that reconnects blocks for the whole TCP
+  // connect and TLS handshake; the others only wait out the reconnect interval
+  unsigned long start = micros();
+  socket.loop();
+  unsigned long elapsed = micros() - start;
+  if (elapsed >= HUB_CONNECT_MIN_TIME)
+  {
+    // A new attempt means the previous one never got as far as the upgrade
+    if (pendingConnectTime[hub])
+      postHubConnectTime(hub, pendingConnectTime[hub], false);
+    pendingConnectTime[hub] = elapsed;
+  }
 
-  webSocket.onEvent(webSocketEvent);
+  // The upgrade reply can land a few calls after the handshake
+  if (pendingConnectTime[hub] && socket.isConnected())
+  {
+    postHubConnectTime(hub, pendingConnectTime[hub], true,
+                       (socket.sessionOffered() ? CONNECT_TLS_OFFERED : 0) |
+                           (socket.sessionResumed() ? CONNECT_TLS_RESUMED : 0));
+    pendingConnectTime[hub] = 0;
+  }
+}
 
-  Serial.println("WebSocket setup completed");
+bool sendWebSocketFrame(uint8_t hub, uint8_t *payload, size_t length)
+{
+  // headerToPayload: the caller leaves room for the frame header in front
+  // of the payload, so the library writes it in place instead of copying
+  return hubSockets[hub].sendTXT(payload, length, true);
 }
 
 // Helper function to extract a value after a given key.
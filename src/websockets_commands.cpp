@@ -1,145 +1,164 @@
 #include "websockets_commands.h"
-#include <ArduinoJson.h>
+#include "command_encoder.h"
+#include "websockets.h"
+#include "hub_task.h"
+#include "config.h"
+#include "log.h"
 #include "globals.h"
 
-void sendGetZonesCommand()
+// Hub task state below; only the send*Command() functions run on the loop() core
+
+// Types of the commands sent to the hub, by slot, to route their replies
+struct SentCommand
 {
-  // Create a document for the inner message
-  StaticJsonDocument<256> innerDoc;
-  innerDoc["token"] = config.api_key;
-  JsonArray commands = innerDoc.createNestedArray("COMMANDS");
-  JsonObject cmd = commands.createNestedObject();
-  // Note: Keep the inner command exactly as required by your API.
-  cmd["COMMAND"] = "{'GET_ZONES': 1}";
-  cmd["COMMANDID"] = 1;
-
-  // Serialize inner JSON to a string
-  String innerStr;
-  serializeJson(innerDoc, innerStr);
-
-  // Create the outer document
-  StaticJsonDocument<256> outerDoc;
-  outerDoc["message_type"] = "hm_get_command_queue";
-  outerDoc["message"] = innerStr;
-
-  // Serialize the entire document to a string
-  String command;
-  serializeJson(outerDoc, command);
-
-  // Optional: Print to Serial for debugging purposes
-  Serial.println(command);
-
-  // Send the command over the WebSocket
-  webSocket.sendTXT(command);
-}
+  uint32_t commandId;
+  CommandType type;
+};
 
-void sendGetTemperatureCommand(String zoneName)
+// Everything one hub task needs to batch and send its commands
+struct CommandPipeline
 {
-  // Build the inner JSON message
-  StaticJsonDocument<256> innerDoc;
-  innerDoc["token"] = config.api_key; // use your stored API key
-
-  // Create the COMMANDS array with one command object
-  JsonArray commands = innerDoc.createNestedArray("COMMANDS");
-  JsonObject commandObj = commands.createNestedObject();
-  // Set the command string exactly as expected
-  commandObj["COMMAND"] = "{'GET_LIVE_DATA':1}";
-  commandObj["COMMANDID"] = 2; // adjust this ID as required
-
-  // Serialize the inner document to a string
-  String innerMessage;
-  serializeJson(innerDoc, innerMessage);
-
-  // Build the outer JSON message
-  StaticJsonDocument<256> outerDoc;
-  outerDoc["message_type"] = "hm_get_command_queue";
-  outerDoc["message"] = innerMessage;
-
-  // Serialize the entire outer JSON document to a string
-  String fullCommand;
-  serializeJson(outerDoc, fullCommand);
-
-  // For debugging: output the command to Serial
-  Serial.println(fullCommand);
-
-  // Send the command over the WebSocket connection
-  webSocket.sendTXT(fullCommand);
-}
+  // Reused for every frame
+  CommandEncoder encoder;
+
+  // Commands waiting for the current batch to be flushed
+  HubCommand queue[COMMAND_BATCH_MAX];
+  uint8_t queuedCount;
+  unsigned long batchOpenedAt;
 
-void sendSetTemperatureCommand(String zone, float temperature)
+  SentCommand sentCommands[MAX_PENDING_COMMANDS];
+};
+
+static CommandPipeline pipelines[MAX_HUBS];
+
+static bool encodeCommand(CommandEncoder &encoder, const HubCommand &command)
 {
-  // Build the inner JSON message
-  StaticJsonDocument<256> innerDoc;
-  innerDoc["token"] = config.api_key;
-
-  // Create the COMMANDS array with one command object
-  JsonArray commands = innerDoc.createNestedArray("COMMANDS");
-  JsonObject commandObj = commands.createNestedObject();
-  // Build the command string as required: {'SET_TEMP': [20.0,'Living Room']}
-  String commandString = "{'SET_TEMP': [" + String(temperature, 1) + ",'" + zone + "']}";
-  commandObj["COMMAND"] = commandString;
-  // Set the command ID to match your Postman example (2 in this case)
-  commandObj["COMMANDID"] = 2;
-
-  // Serialize the inner JSON document to a string
-  String innerMessage;
-  serializeJson(innerDoc, innerMessage);
-
-  // Build the outer JSON message
-  StaticJsonDocument<256> outerDoc;
-  outerDoc["message_type"] = "hm_get_command_queue";
-  outerDoc["message"] = innerMessage;
-
-  // Serialize the complete outer JSON document to a string
-  String fullCommand;
-  serializeJson(outerDoc, fullCommand);
-
-  // For debugging: print the command to Serial to verify the output
-  Serial.println("Sending command: " + fullCommand);
-
-  // Send the command over the WebSocket connection
-  webSocket.sendTXT(fullCommand);
+  switch (command.type)
+  {
+  case CMD_GET_ZONES:
+    return encoder.addGetZones(command.commandId);
+  case CMD_GET_LIVE_DATA:
+    return encoder.addGetLiveData(command.commandId);
+  case CMD_SET_TEMP:
+    return encoder.addSetTemp(command.commandId, command.zone, command.temperature);
+  case CMD_FROST:
+    return encoder.addFrost(command.commandId, command.zone, command.on);
+  }
+  return false;
 }
 
-void sendStandbyCommand(String zone, bool on)
+void flushCommands(uint8_t hub)
 {
-  // Create the inner JSON document for the message
-  StaticJsonDocument<256> innerDoc;
-  innerDoc["token"] = config.api_key;
+  CommandPipeline &pipeline = pipelines[hub];
+  CommandEncoder &encoder = pipeline.encoder;
+  uint8_t next = 0;
 
-  // Create the COMMANDS array with one command object
-  JsonArray commands = innerDoc.createNestedArray("COMMANDS");
-  JsonObject commandObj = commands.createNestedObject();
-
-  // Build the command string based on the 'on' parameter
-  String commandStr;
-  if (on)
+  while (next < pipeline.queuedCount)
   {
-    commandStr = "{'FROST_ON':['" + zone + "']}";
+    // Pack as many queued commands as fit into one frame
+    uint8_t first = next;
+    encoder.begin(getHubApiKey(hub));
+    while (next < pipeline.queuedCount && encodeCommand(encoder, pipeline.queue[next]))
+      next++;
+
+    if (next == first)
+    {
+      LOG_ERROR("Command does not fit in frame buffer");
+      postHubEvent(hub, HUB_EVENT_REPLY, pipeline.queue[next++].commandId, COMMAND_FAILED);
+      continue;
+    }
+
+    bool encoded = encoder.finish();
+
+    LOG_VERBOSE("Sending %u command(s) to hub %u: %.*s", encoder.commandCount(), (unsigned)hub + 1,
+                (int)encoder.length(), (const char *)encoder.payload());
+
+    // The encoder leaves header room in front of the payload, so the frame
+    // header is written in place instead of the payload being copied
+    if (!encoded || !sendWebSocketFrame(hub, encoder.payload(), encoder.length()))
+    {
+      for (uint8_t i = first; i < next; i++)
+        postHubEvent(hub, HUB_EVENT_REPLY, pipeline.queue[i].commandId, COMMAND_FAILED);
+      continue;
+    }
+
+    for (uint8_t i = first; i < next; i++)
+    {
+      SentCommand &sent = pipeline.sentCommands[pipeline.queue[i].commandId & (MAX_PENDING_COMMANDS - 1)];
+      sent.commandId = pipeline.queue[i].commandId;
+      sent.type = pipeline.queue[i].type;
+    }
   }
-  else
+  pipeline.queuedCount = 0;
+}
+
+void serviceCommandQueue(uint8_t hub)
+{
+  CommandPipeline &pipeline = pipelines[hub];
+  HubCommand command;
+  while (pipeline.queuedCount < COMMAND_BATCH_MAX && takeHubCommand(hub, command))
   {
-    commandStr = "{'FROST_OFF':['" + zone + "']}";
+    if (pipeline.queuedCount == 0)
+      pipeline.batchOpenedAt = millis();
+    pipeline.queue[pipeline.queuedCount++] = command;
   }
-  commandObj["COMMAND"] = commandStr;
-  commandObj["COMMANDID"] = 4;
 
-  // Serialize the inner document to a string
-  String innerMessage;
-  serializeJson(innerDoc, innerMessage);
+  if (pipeline.queuedCount > 0 &&
+      (pipeline.queuedCount >= COMMAND_BATCH_MAX || millis() - pipeline.batchOpenedAt >= COMMAND_BATCH_WINDOW))
+    flushCommands(hub);
+}
+
+bool lookupSentCommand(uint8_t hub, uint32_t commandId, CommandType &type)
+{
+  const SentCommand &sent = pipelines[hub].sentCommands[commandId & (MAX_PENDING_COMMANDS - 1)];
+  if (commandId == 0 || sent.commandId != commandId)
+    return false;
+
+  type = sent.type;
+  return true;
+}
 
-  // Create the outer JSON document with the message type and nested inner message
-  StaticJsonDocument<256> outerDoc;
-  outerDoc["message_type"] = "hm_get_command_queue";
-  outerDoc["message"] = innerMessage;
+static uint32_t queueCommand(uint8_t hub, CommandType type, unsigned long timeout, CommandCallback onComplete,
+                             int zoneId = -1, float temperature = 0, bool on = false)
+{
+  HubCommand command;
+  command.type = type;
+  command.on = on;
+  command.temperature = temperature;
+  command.zone[0] = '\0';
+  if (zoneId >= 0 && !copyZoneLocalName(zoneId, command.zone, sizeof(command.zone)))
+    return 0;
+
+  uint32_t commandId = registerCommand(hub, type, timeout, onComplete);
+  if (!commandId)
+    return 0;
+  command.commandId = commandId;
+
+  if (!postHubCommand(hub, command))
+  {
+    LOG_WARN("Hub %u command queue full, dropping command", (unsigned)hub + 1);
+    cancelCommand(commandId);
+    return 0;
+  }
+  return commandId;
+}
 
-  // Serialize the outer document to the final command string
-  String fullCommand;
-  serializeJson(outerDoc, fullCommand);
+uint32_t sendGetZonesCommand(uint8_t hub, CommandCallback onComplete)
+{
+  return queueCommand(hub, CMD_GET_ZONES, COMMAND_TIMEOUT, onComplete);
+}
 
-  // Debug output to verify the generated command
-  Serial.println("Sending command: " + fullCommand);
+uint32_t sendGetTemperatureCommand(uint8_t hub, CommandCallback onComplete)
+{
+  return queueCommand(hub, CMD_GET_LIVE_DATA, TEMP_TIMEOUT, onComplete);
+}
 
-  // Send the command over the WebSocket connection
-  webSocket.sendTXT(fullCommand);
-}
\ No newline at end of file
+uint32_t sendSetTemperatureCommand(int zoneId, float temperature, CommandCallback onComplete)
+{
+  return queueCommand(getZoneHub(zoneId), CMD_SET_TEMP, COMMAND_TIMEOUT, onComplete, zoneId, temperature);
+}
+
+uint32_t sendStandbyCommand(int zoneId, bool on, CommandCallback onComplete)
+{
+  return queueCommand(getZoneHub(zoneId), CMD_FROST, COMMAND_TIMEOUT, onComplete, zoneId, 0, on);
+}
@@ -0,0 +1,148 @@
+#include "zone_commands.h"
+#include "zone_table.h"
+#include "temperature_cache.h"
+#include "websockets_commands.h"
+#include "live_data_poller.h"
+#include "log.h"
+
+// One debounced value for one zone: either its set point or its standby state
+struct DebouncedCommand
+{
+  float desired;
+  float inFlight;
+  unsigned long firstRequestAt;
+  unsigned long lastRequestAt;
+  uint32_t inFlightId;
+  bool hasDesired;
+  bool hasInFlight;
+};
+
+static DebouncedCommand setPoints[MAX_ZONES];
+static DebouncedCommand standbys[MAX_ZONES];
+
+// The value the hub last reported or acknowledged, if any. A state restored
+// after a reboot only has its temperature, so nothing is suppressed against it.
+static bool currentValue(int zoneId, CommandType type, float &value)
+{
+  ZoneState state;
+  if (!getZoneState(zoneId, state) || !(state.flags & ZONE_HAS_STATE))
+    return false;
+
+  value = type == CMD_SET_TEMP ? state.setTemp : (state.flags & ZONE_STANDBY) ? 1 : 0;
+  return true;
+}
+
+static bool request(DebouncedCommand &command, int zoneId, CommandType type, float value)
+{
+  float current;
+  bool redundant = command.hasInFlight ? command.inFlight == value
+                                       : currentValue(zoneId, type, current) && current == value;
+  if (redundant)
+  {
+    // Last writer wins: an earlier, different request is dropped too
+    command.hasDesired = false;
+    return false;
+  }
+
+  unsigned long now = millis();
+  if (!command.hasDesired)
+    command.firstRequestAt = now;
+  command.lastRequestAt = now;
+  command.desired = value;
+  command.hasDesired = true;
+  return true;
+}
+
+bool requestSetTemperature(int zoneId, float temperature)
+{
+  if (zoneId < 0 || zoneId >= MAX_ZONES)
+    return false;
+  return request(setPoints[zoneId], zoneId, CMD_SET_TEMP, temperature);
+}
+
+bool requestStandby(int zoneId, bool on)
+{
+  if (zoneId < 0 || zoneId >= MAX_ZONES)
+    return false;
+  return request(standbys[zoneId], zoneId, CMD_FROST, on ? 1 : 0);
+}
+
+// Records an acknowledged command in the zone's state so the next identical
+// request is suppressed before the next live data poll confirms it
+static void acknowledge(int zoneId, CommandType type, float value)
+{
+  ZoneState state;
+  if (!getZoneState(zoneId, state))
+    return;
+
+  if (type == CMD_SET_TEMP)
+    state.setTemp = value;
+  else if (value)
+    state.flags |= ZONE_STANDBY;
+  else
+    state.flags &= ~ZONE_STANDBY;
+  updateZoneState(zoneId, state);
+}
+
+static void sendSettled(DebouncedCommand &command, int zoneId, CommandType type, unsigned long now)
+{
+  if (!command.hasDesired || command.hasInFlight)
+    return;
+  if (now - command.lastRequestAt < COMMAND_SETTLE_WINDOW && now - command.firstRequestAt < COMMAND_SETTLE_MAX)
+    return;
+
+  // The hub may have reached this value on its own while we waited
+  float current;
+  if (currentValue(zoneId, type, current) && current == command.desired)
+  {
+    command.hasDesired = false;
+    return;
+  }
+
+  float value = command.desired;
+  auto onComplete = [&command, zoneId, type, value](uint32_t commandId, CommandStatus status)
+  {
+    // The zone was removed while the command was in flight
+    if (commandId != command.inFlightId)
+      return;
+
+    command.hasInFlight = false;
+    command.inFlightId = 0;
+    if (status == COMMAND_OK)
+      acknowledge(zoneId, type, value);
+    pollSoon(getZoneHub(zoneId));
+  };
+
+  uint32_t commandId = type == CMD_SET_TEMP ? sendSetTemperatureCommand(zoneId, value, onComplete)
+                                            : sendStandbyCommand(zoneId, value != 0, onComplete);
+  if (!commandId)
+  {
+    // Keep the request and retry on the next pass
+    LOG_WARN("Could not queue command for zone %s", getZoneName(zoneId));
+    return;
+  }
+
+  command.hasDesired = false;
+  command.inFlight = value;
+  command.inFlightId = commandId;
+  command.hasInFlight = true;
+}
+
+void forgetZoneCommands(int zoneId)
+{
+  if (zoneId < 0 || zoneId >= MAX_ZONES)
+    return;
+
+  setPoints[zoneId] = DebouncedCommand();
+  standbys[zoneId] = DebouncedCommand();
+}
+
+void serviceZoneCommands()
+{
+  unsigned long now = millis();
+  for (int zoneId = 0; zoneId < getZoneCount(); zoneId++)
+  {
+    sendSettled(setPoints[zoneId], zoneId, CMD_SET_TEMP, now);
+    sendSettled(standbys[zoneId], zoneId, CMD_FROST, now);
+  }
+}
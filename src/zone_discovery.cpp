@@ -0,0 +1,121 @@
+#include "zone_discovery.h"
+#include "zone_table.h"
+#include "zone_commands.h"
+#include "zone_history.h"
+#include "websockets_commands.h"
+#include "hub_task.h"
+#include "config.h"
+#include "log.h"
+#include "globals.h"
+
+static_assert(MAX_ZONES <= 64, "Seen zones are tracked in a 64-bit mask");
+
+// The GET_ZONES request in flight to one hub and the zones its reply listed so far
+struct HubDiscovery
+{
+  uint32_t commandId;
+  uint64_t seen; // Bit per zone ID
+  unsigned long startedAt;
+};
+static HubDiscovery discoveries[MAX_HUBS];
+
+static void forgetZone(int zoneId)
+{
+  LOG_INFO("Zone removed: %s", getZoneName(zoneId));
+  forgetZoneCommands(zoneId);
+  clearZoneHistory(zoneId);
+  removeZone(zoneId);
+}
+
+static void finishDiscovery(uint8_t hub, uint32_t commandId, CommandStatus status)
+{
+  HubDiscovery &discovery = discoveries[hub];
+  if (commandId != discovery.commandId)
+    return;
+  discovery.commandId = 0;
+
+  // Only a complete zone list proves that a zone is gone
+  if (status != COMMAND_OK)
+    return;
+
+  for (int zoneId = 0; zoneId < getZoneCount(); zoneId++)
+  {
+    if (getZoneName(zoneId) && getZoneHub(zoneId) == hub && !(discovery.seen & (1ULL << zoneId)))
+      forgetZone(zoneId);
+  }
+}
+
+void refreshZoneCatalog(uint8_t hub)
+{
+  HubDiscovery &discovery = discoveries[hub];
+  if (isCommandPending(discovery.commandId))
+    return;
+
+  discovery.seen = 0;
+  discovery.startedAt = millis();
+  discovery.commandId = sendGetZonesCommand(hub, [hub](uint32_t commandId, CommandStatus status)
+                                            { finishDiscovery(hub, commandId, status); });
+}
+
+void refreshZoneCatalogSoon(uint8_t hub)
+{
+  if (millis() - discoveries[hub].startedAt >= ZONE_REFRESH_MIN_INTERVAL)
+    refreshZoneCatalog(hub);
+}
+
+// A zone of this hub with the same device number that the reply has not
+// listed yet is the same zone under a new name
+static int findRenamedZone(uint8_t hub, uint16_t deviceId, uint64_t seen)
+{
+  if (!deviceId)
+    return -1;
+
+  for (int zoneId = 0; zoneId < getZoneCount(); zoneId++)
+  {
+    if (getZoneName(zoneId) && getZoneHub(zoneId) == hub && getZoneDeviceId(zoneId) == deviceId &&
+        !(seen & (1ULL << zoneId)))
+      return zoneId;
+  }
+  return -1;
+}
+
+void discoverZone(uint8_t hub, const char *localName, uint16_t deviceId)
+{
+  HubDiscovery &discovery = discoveries[hub];
+  int zoneId = findHubZone(hub, localName);
+
+  if (zoneId < 0)
+  {
+    int renamed = findRenamedZone(hub, deviceId, discovery.seen);
+    if (renamed >= 0)
+    {
+      LOG_INFO("Zone renamed: %s -> %s", getZoneName(renamed), localName);
+      if (renameZone(renamed, localName))
+        zoneId = renamed;
+    }
+  }
+
+  if (zoneId < 0)
+  {
+    zoneId = addHubZone(hub, localName);
+    if (zoneId < 0)
+    {
+      LOG_WARN("Zone table full, skipping: %s", localName);
+      return;
+    }
+    LOG_INFO("Zone added: %s", getZoneName(zoneId));
+  }
+
+  setZoneDeviceId(zoneId, deviceId);
+  discovery.seen |= 1ULL << zoneId;
+}
+
+void serviceZoneDiscovery()
+{
+  unsigned long now = millis();
+  for (uint8_t hub = 0; hub < getHubCount(); hub++)
+  {
+    if (isHubConnected(hub) && now - discoveries[hub].startedAt >= ZONE_REFRESH_INTERVAL)
+      refreshZoneCatalog(hub);
+  }
+}
@@ -0,0 +1,217 @@
+#include "zone_history.h"
+#include "zone_table.h"
+#include <math.h>
+#include <stdlib.h>
+
+// A block starts with an absolute keyframe; every later sample is stored as
+// a varint of zigzag(temperature delta in tenths) << 1, with the low bit set
+// when the time delta is not exactly HISTORY_SAMPLE_INTERVAL and follows as
+// its own varint. Times sit on the HISTORY_SAMPLE_INTERVAL grid, so only a
+// missed interval is irregular and a polled series costs one byte per sample.
+struct HistoryBlock
+{
+  uint32_t startTime;
+  int16_t startValue; // Tenths of a degree
+  uint8_t length;     // Bytes used in data
+  uint8_t count;      // Samples, including the keyframe
+  uint8_t data[HISTORY_BLOCK_SIZE - 8];
+};
+
+#define HISTORY_BLOCKS_PER_ZONE (HISTORY_BYTES_PER_ZONE / HISTORY_BLOCK_SIZE)
+#define HISTORY_ZONE_BYTES (HISTORY_BLOCKS_PER_ZONE * sizeof(HistoryBlock))
+#define HISTORY_MAX_SAMPLE_BYTES 10 // Two five-byte varints
+
+static_assert(sizeof(HistoryBlock) == HISTORY_BLOCK_SIZE, "HistoryBlock must be HISTORY_BLOCK_SIZE bytes");
+
+struct ZoneHistory
+{
+  HistoryBlock *blocks; // Ring of HISTORY_BLOCKS_PER_ZONE
+  uint8_t first;
+  uint8_t count;
+  uint32_t lastTime;
+  int16_t lastValue;
+  bool refused; // Found the pool empty; cleared when the ID is freed
+};
+
+static ZoneHistory histories[MAX_ZONES];
+static HistoryBlock *historyPool = nullptr;
+static uint8_t poolZones = 0; // Buffers the pool holds
+static uint8_t poolUsed = 0;  // Buffers handed out; they stay with their zone ID
+static uint32_t allocationFailures = 0;
+
+void reserveZoneHistory()
+{
+  if (historyPool)
+    return;
+
+  for (int zones = HISTORY_POOL_ZONES; zones > 0 && !historyPool; zones /= 2)
+  {
+    historyPool = (HistoryBlock *)malloc(zones * HISTORY_ZONE_BYTES);
+    if (historyPool)
+      poolZones = zones;
+  }
+}
+
+static uint32_t zigzag(int32_t value)
+{
+  return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+static int32_t unzigzag(uint32_t value)
+{
+  return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
+
+static uint8_t *writeVarint(uint8_t *out, uint32_t value)
+{
+  while (value >= 0x80)
+  {
+    *out++ = (uint8_t)(value | 0x80);
+    value >>= 7;
+  }
+  *out++ = (uint8_t)value;
+  return out;
+}
+
+static const uint8_t *readVarint(const uint8_t *in, const uint8_t *end, uint32_t &value)
+{
+  value = 0;
+  for (int shift = 0; in < end && shift < 35; shift += 7)
+  {
+    uint8_t byte = *in++;
+    value |= (uint32_t)(byte & 0x7F) << shift;
+    if (!(byte & 0x80))
+      return in;
+  }
+  return nullptr;
+}
+
+static HistoryBlock &blockAt(ZoneHistory &history, int index)
+{
+  return history.blocks[(history.first + index) % HISTORY_BLOCKS_PER_ZONE];
+}
+
+static void startBlock(ZoneHistory &history, uint32_t time, int16_t value)
+{
+  if (history.count == HISTORY_BLOCKS_PER_ZONE)
+  {
+    history.first = (history.first + 1) % HISTORY_BLOCKS_PER_ZONE;
+    history.count--;
+  }
+
+  HistoryBlock &block = blockAt(history, history.count++);
+  block.startTime = time;
+  block.startValue = value;
+  block.length = 0;
+  block.count = 1;
+}
+
+void recordZoneHistory(int zoneId, uint32_t time, float temperature)
+{
+  if (zoneId < 0 || zoneId >= MAX_ZONES)
+    return;
+
+  ZoneHistory &history = histories[zoneId];
+  if (!history.blocks)
+  {
+    if (history.refused)
+      return;
+    if (poolUsed >= poolZones)
+    {
+      history.refused = true;
+      allocationFailures++;
+      return;
+    }
+    history.blocks = historyPool + poolUsed++ * HISTORY_BLOCKS_PER_ZONE;
+  }
+
+  // Readings arrive whenever the adaptive poll lands, so snap them to the
+  // sample grid; otherwise jitter makes almost every delta irregular
+  time -= time % HISTORY_SAMPLE_INTERVAL;
+  int16_t value = (int16_t)lroundf(temperature * 10);
+  if (history.count > 0 && time - history.lastTime < HISTORY_SAMPLE_INTERVAL)
+    return;
+
+  HistoryBlock *block = history.count > 0 ? &blockAt(history, history.count - 1) : nullptr;
+  if (!block || block->count == 255 || block->length + HISTORY_MAX_SAMPLE_BYTES > (int)sizeof(block->data))
+  {
+    startBlock(history, time, value);
+  }
+  else
+  {
+    uint32_t elapsed = time - history.lastTime;
+    bool irregular = elapsed != HISTORY_SAMPLE_INTERVAL;
+    uint8_t *out = block->data + block->length;
+    out = writeVarint(out, (zigzag(value - history.lastValue) << 1) | irregular);
+    if (irregular)
+      out = writeVarint(out, elapsed);
+    block->length = out - block->data;
+    block->count++;
+  }
+
+  history.lastTime = time;
+  history.lastValue = value;
+}
+
+void clearZoneHistory(int zoneId)
+{
+  if (zoneId < 0 || zoneId >= MAX_ZONES)
+    return;
+
+  histories[zoneId].first = 0;
+  histories[zoneId].count = 0;
+  histories[zoneId].refused = false; // A zone reusing the ID may find room
+}
+
+void forEachZoneHistorySample(int zoneId, uint32_t from, uint32_t to, HistorySampleCallback onSample, void *context)
+{
+  if (zoneId < 0 || zoneId >= MAX_ZONES || !histories[zoneId].blocks)
+    return;
+
+  ZoneHistory &history = histories[zoneId];
+  for (int i = 0; i < history.count; i++)
+  {
+    const HistoryBlock &block = blockAt(history, i);
+    if (block.startTime >= to)
+      return;
+
+    // Skip blocks that end before the range starts
+    if (i + 1 < history.count && blockAt(history, i + 1).startTime <= from)
+      continue;
+
+    uint32_t time = block.startTime;
+    int32_t value = block.startValue;
+    const uint8_t *in = block.data;
+    const uint8_t *end = block.data + block.length;
+    for (int sample = 0; sample < block.count; sample++)
+    {
+      if (sample > 0)
+      {
+        uint32_t encoded;
+        uint32_t elapsed = HISTORY_SAMPLE_INTERVAL;
+        in = readVarint(in, end, encoded);
+        if (in && (encoded & 1))
+          in = readVarint(in, end, elapsed);
+        if (!in)
+          break;
+        value += unzigzag(encoded >> 1);
+        time += elapsed;
+      }
+
+      if (time >= to)
+        return;
+      if (time >= from)
+        onSample(time, value / 10.0f, context);
+    }
+  }
+}
+
+size_t getZoneHistoryMemory()
+{
+  return poolUsed * HISTORY_ZONE_BYTES;
+}
+
+uint32_t getZoneHistoryAllocationFailures()
+{
+  return allocationFailures;
+}
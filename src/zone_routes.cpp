@@ -0,0 +1,393 @@
+#include <ArduinoJson.h>
+#include <stdarg.h>
+#include <time.h>
+#include "zone_routes.h"
+#include "zone_table.h"
+#include "zone_commands.h"
+#include "deferred_response.h"
+#include "temperature_cache.h"
+#include "metrics.h"
+#include "zone_history.h"
+#include "log.h"
+#include "globals.h"
+
+enum ZoneAction : uint8_t
+{
+  ACTION_STANDBY_ON,
+  ACTION_STANDBY_OFF,
+  ACTION_SET_TEMP,
+  ACTION_GET_TEMP,
+  ACTION_GET_STATE,
+  ACTION_HISTORY
+};
+
+struct ZoneRoute
+{
+  const char *prefix;
+  uint8_t prefixLength;
+  ZoneAction action;
+};
+
+static const ZoneRoute zoneRoutes[] = {
+    {"/standby_on/", 12, ACTION_STANDBY_ON},
+    {"/standby_off/", 13, ACTION_STANDBY_OFF},
+    {"/set_temp/", 10, ACTION_SET_TEMP},
+    {"/get_temp/", 10, ACTION_GET_TEMP},
+    {"/zone/", 6, ACTION_GET_STATE},
+    {"/history/", 9, ACTION_HISTORY},
+};
+
+static const ZoneRoute *matchZoneRoute(const String &uri)
+{
+  for (const ZoneRoute &route : zoneRoutes)
+  {
+    if (strncmp(uri.c_str(), route.prefix, route.prefixLength) == 0)
+      return &route;
+  }
+  return nullptr;
+}
+
+static int hexDigit(char c)
+{
+  if (c >= '0' && c <= '9')
+    return c - '0';
+  if (c >= 'a' && c <= 'f')
+    return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F')
+    return c - 'A' + 10;
+  return -1;
+}
+
+// Decodes a URL path segment ('+' and %XX) into out. Returns false if it does not fit.
+static bool urlDecode(const char *in, char *out, size_t outSize)
+{
+  size_t length = 0;
+  while (*in)
+  {
+    char c = *in++;
+    if (c == '+')
+    {
+      c = ' ';
+    }
+    else if (c == '%' && hexDigit(in[0]) >= 0 && hexDigit(in[1]) >= 0)
+    {
+      c = (char)((hexDigit(in[0]) << 4) | hexDigit(in[1]));
+      in += 2;
+    }
+
+    if (length + 1 >= outSize)
+      return false;
+    out[length++] = c;
+  }
+  out[length] = '\0';
+  return true;
+}
+
+static void handleStandby(int zoneId, bool on)
+{
+  const char *zoneName = getZoneName(zoneId);
+  LOG_DEBUG("Standby %s request for zone: %s", on ? "ON" : "OFF", zoneName);
+  bool queued = requestStandby(zoneId, on);
+  server.send(200, "text/plain",
+              "Standby " + String(on ? "ON" : "OFF") + (queued ? " sent" : " already set") + " for: " + zoneName);
+}
+
+static void handleSetTemp(int zoneId)
+{
+  if (server.hasArg("temp"))
+  {
+    const char *zoneName = getZoneName(zoneId);
+    float temp = server.arg("temp").toFloat();
+    LOG_DEBUG("Setting temperature for zone %s to %.1f", zoneName, temp);
+    bool queued = requestSetTemperature(zoneId, temp);
+    server.send(200, "text/plain",
+                String(queued ? "Temperature set to " : "Temperature already at ") + String(temp) + " for zone: " + zoneName);
+  }
+  else
+  {
+    server.send(400, "text/plain", "Missing temp parameter");
+  }
+}
+
+// Body for /get_temp (temperature only) or /zone (the full state)
+static String zoneJson(const char *zoneName, const ZoneState &state, bool fullState)
+{
+  StaticJsonDocument<JSON_OBJECT_SIZE(7)> doc;
+  doc["zone"] = zoneName;
+  doc["temperature"] = serialized(String(state.actualTemp, 1));
+  if (fullState)
+  {
+    // A zone restored after a reboot only knows its temperature until the
+    // hub's first live reply
+    if (state.flags & ZONE_HAS_STATE)
+    {
+      doc["set_temp"] = serialized(String(state.setTemp, 1));
+      doc["heat_on"] = (state.flags & ZONE_HEAT_ON) != 0;
+      doc["standby"] = (state.flags & ZONE_STANDBY) != 0;
+      doc["hold_on"] = (state.flags & ZONE_HOLD_ON) != 0;
+    }
+    doc["age_ms"] = millis() - state.updatedAt;
+  }
+
+  String response;
+  serializeJson(doc, response);
+  return response;
+}
+
+static void handleGetTemp(int zoneId, bool fullState)
+{
+  const char *zoneName = getZoneName(zoneId);
+  ZoneState state;
+  CacheResult cached = lookupZoneState(zoneId, state);
+
+  // If we have a cached value, return it
+  if (cached != CACHE_MISS)
+  {
+    server.send(200, "application/json", zoneJson(zoneName, state, fullState));
+
+    // Revalidate stale values in the background
+    if (cached == CACHE_STALE)
+      refreshLiveData(getZoneHub(zoneId));
+    return;
+  }
+
+  // No cached value - park the request until the hub replies,
+  // so other clients keep being served in the meantime
+  unsigned long parkedAt = micros();
+  uint32_t handle = deferResponse(TEMP_TIMEOUT, [zoneId, fullState, parkedAt](WiFiClient &client, bool timedOut)
+                                  {
+    recordHttpLatency(ROUTE_GET_TEMP_DEFERRED, micros() - parkedAt);
+    const char *zoneName = getZoneName(zoneId);
+    if (!zoneName) {
+      // The hub dropped the zone while the request was parked
+      sendDeferredResponse(client, 404, "text/plain", "Unknown zone");
+      return;
+    }
+    ZoneState state;
+    if (lookupZoneState(zoneId, state) != CACHE_MISS) {
+      sendDeferredResponse(client, 200, "application/json", zoneJson(zoneName, state, fullState));
+      return;
+    }
+
+    // No reading arrived in time
+    sendDeferredResponse(client, 202, "text/plain",
+                         "Temperature request sent for zone: " + String(zoneName) +
+                             ". Please try again in a few seconds."); });
+
+  if (!handle)
+  {
+    server.send(503, "text/plain", "Too many pending requests");
+    return;
+  }
+
+  refreshLiveData(getZoneHub(zoneId), [handle](uint32_t, CommandStatus)
+                  { resolveDeferredResponse(handle); });
+}
+
+#define HISTORY_MAX_BUCKETS 1440
+#define HISTORY_CHUNK_SIZE 512
+
+// Downsamples history into buckets and streams each finished one as a chunk
+struct HistoryStream
+{
+  uint32_t from;
+  uint32_t step;
+  long clockOffset; // Added to uptime seconds to get reported timestamps
+  uint32_t bucket;
+  uint32_t samples;
+  float min;
+  float max;
+  float sum;
+  bool firstPoint;
+  size_t length;
+  char chunk[HISTORY_CHUNK_SIZE];
+};
+
+static void flushHistory(HistoryStream &stream)
+{
+  if (stream.length)
+    server.sendContent(stream.chunk, stream.length);
+  stream.length = 0;
+}
+
+static void appendHistory(HistoryStream &stream, const char *format, ...) __attribute__((format(printf, 2, 3)));
+static void appendHistory(HistoryStream &stream, const char *format, ...)
+{
+  if (stream.length > HISTORY_CHUNK_SIZE - 64)
+    flushHistory(stream);
+
+  va_list args;
+  va_start(args, format);
+  int written = vsnprintf(stream.chunk + stream.length, HISTORY_CHUNK_SIZE - stream.length, format, args);
+  va_end(args);
+  if (written > 0)
+    stream.length += min((size_t)written, HISTORY_CHUNK_SIZE - stream.length - 1);
+}
+
+static void emitBucket(HistoryStream &stream)
+{
+  if (!stream.samples)
+    return;
+
+  appendHistory(stream, "%s[%ld,%.1f,%.1f,%.1f]", stream.firstPoint ? "" : ",",
+                (long)(stream.from + stream.bucket * stream.step) + stream.clockOffset,
+                stream.min, stream.sum / stream.samples, stream.max);
+  stream.firstPoint = false;
+  stream.samples = 0;
+}
+
+static void addHistorySample(uint32_t time, float temperature, void *context)
+{
+  HistoryStream &stream = *(HistoryStream *)context;
+  uint32_t bucket = (time - stream.from) / stream.step;
+  if (bucket != stream.bucket)
+  {
+    emitBucket(stream);
+    stream.bucket = bucket;
+  }
+
+  if (!stream.samples)
+  {
+    stream.min = stream.max = stream.sum = temperature;
+  }
+  else
+  {
+    stream.min = min(stream.min, temperature);
+    stream.max = max(stream.max, temperature);
+    stream.sum += temperature;
+  }
+  stream.samples++;
+}
+
+// Reads a time argument. Negative values count back from now; others are
+// Unix time once SNTP has set the clock, uptime seconds before that.
+static long historyTimeArg(const char *name, long fallback, long now)
+{
+  if (!server.hasArg(name))
+    return fallback;
+  long value = server.arg(name).toInt();
+  return value < 0 ? now + value : value;
+}
+
+// GET /history/<zone>?from=&to=&step= answers
+// {"zone":...,"step":...,"points":[[time,min,avg,max],...]}, one point per
+// bucket that has samples
+static void handleHistory(int zoneId)
+{
+  long uptime = (long)(esp_timer_get_time() / 1000000);
+  time_t wallClock = time(nullptr);
+  long clockOffset = wallClock > 1600000000 ? (long)wallClock - uptime : 0;
+  long now = uptime + clockOffset;
+
+  long to = historyTimeArg("to", now, now);
+  long from = historyTimeArg("from", to - 3600, now);
+  long step = server.hasArg("step") ? server.arg("step").toInt() : HISTORY_SAMPLE_INTERVAL;
+  if (step <= 0 || from >= to || (to - from) / step > HISTORY_MAX_BUCKETS)
+  {
+    server.send(400, "text/plain", "Invalid from, to or step");
+    return;
+  }
+
+  // Stored samples use uptime seconds
+  from = max(from - clockOffset, 0L);
+  to = max(to - clockOffset, 0L);
+
+  // Large and only needed while streaming, so kept off the stack
+  static HistoryStream stream;
+  stream.from = from;
+  stream.step = step;
+  stream.clockOffset = clockOffset;
+  stream.bucket = 0;
+  stream.samples = 0;
+  stream.firstPoint = true;
+  stream.length = 0;
+
+  server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+  server.send(200, "application/json", "");
+
+  StaticJsonDocument<JSON_OBJECT_SIZE(1)> zone;
+  zone["zone"] = getZoneName(zoneId);
+  stream.length = serializeJson(zone, stream.chunk, HISTORY_CHUNK_SIZE) - 1; // Reopen the object
+  appendHistory(stream, ",\"step\":%ld,\"points\":[", step);
+
+  forEachZoneHistorySample(zoneId, from, to, addHistorySample, &stream);
+  emitBucket(stream);
+  appendHistory(stream, "]}");
+  flushHistory(stream);
+  server.sendContent("");
+}
+
+// One handler for all zone endpoints: the action comes from the path prefix
+// and the zone from the hashed zone table, so cost stays flat as zones are added
+class ZoneRequestHandler : public RequestHandler
+{
+public:
+  bool canHandle(HTTPMethod method, String uri) override
+  {
+    return method == HTTP_GET && matchZoneRoute(uri) != nullptr;
+  }
+
+  bool handle(WebServer &, HTTPMethod method, String uri) override
+  {
+    const ZoneRoute *route = matchZoneRoute(uri);
+    if (method != HTTP_GET || !route)
+      return false;
+
+    char decoded[MAX_ZONE_NAME];
+    int zoneId = -1;
+    if (urlDecode(uri.c_str() + route->prefixLength, decoded, sizeof(decoded)))
+      zoneId = findZone(decoded);
+
+    if (zoneId < 0)
+    {
+      server.send(404, "text/plain", "Unknown zone");
+      return true;
+    }
+
+    switch (route->action)
+    {
+    case ACTION_STANDBY_ON:
+    {
+      RouteTimer timer(ROUTE_STANDBY);
+      handleStandby(zoneId, true);
+      break;
+    }
+    case ACTION_STANDBY_OFF:
+    {
+      RouteTimer timer(ROUTE_STANDBY);
+      handleStandby(zoneId, false);
+      break;
+    }
+    case ACTION_SET_TEMP:
+    {
+      RouteTimer timer(ROUTE_SET_TEMP);
+      handleSetTemp(zoneId);
+      break;
+    }
+    case ACTION_GET_TEMP:
+    {
+      RouteTimer timer(ROUTE_GET_TEMP);
+      handleGetTemp(zoneId, false);
+      break;
+    }
+    case ACTION_GET_STATE:
+    {
+      RouteTimer timer(ROUTE_ZONE_STATE);
+      handleGetTemp(zoneId, true);
+      break;
+    }
+    case ACTION_HISTORY:
+    {
+      RouteTimer timer(ROUTE_HISTORY);
+      handleHistory(zoneId);
+      break;
+    }
+    }
+    return true;
+  }
+};
+
+void setupZoneRoutes()
+{
+  server.addHandler(new ZoneRequestHandler());
+}
@@ -0,0 +1,265 @@
+#include "zone_table.h"
+#include <stdio.h>
+#include <string.h>
+
+struct ZoneIndexEntry
+{
+  uint32_t hash;
+  uint8_t zoneId;
+};
+
+static char zoneNames[MAX_ZONES][MAX_ZONE_NAME];
+static uint8_t zoneHubs[MAX_ZONES];
+static uint8_t localNameLengths[MAX_ZONES]; // Public names may carry a hub suffix; 0 marks a free slot
+static uint16_t zoneDeviceIds[MAX_ZONES];
+static int zoneCount = 0;  // One past the highest slot in use
+static int indexCount = 0; // Zones actually in use
+
+// Live state, one array per field so scans over a single field stay compact
+static float actualTemps[MAX_ZONES];
+static float setTemps[MAX_ZONES];
+static uint8_t zoneFlags[MAX_ZONES];
+static uint32_t updatedAts[MAX_ZONES];
+static uint32_t catalogGeneration = 0;
+
+// Sorted by hash so lookups are a binary search over a compact array
+static ZoneIndexEntry zoneIndex[MAX_ZONES];
+
+// FNV-1a
+static uint32_t hashZoneName(const char *name)
+{
+  uint32_t hash = 2166136261UL;
+  while (*name)
+  {
+    hash ^= (uint8_t)*name++;
+    hash *= 16777619UL;
+  }
+  return hash;
+}
+
+// First index entry whose hash is not below the given one
+static int lowerBound(uint32_t hash)
+{
+  int low = 0;
+  int high = indexCount;
+  while (low < high)
+  {
+    int mid = (low + high) / 2;
+    if (zoneIndex[mid].hash < hash)
+      low = mid + 1;
+    else
+      high = mid;
+  }
+  return low;
+}
+
+int findZone(const char *name)
+{
+  uint32_t hash = hashZoneName(name);
+  for (int i = lowerBound(hash); i < indexCount && zoneIndex[i].hash == hash; i++)
+  {
+    if (strcmp(zoneNames[zoneIndex[i].zoneId], name) == 0)
+      return zoneIndex[i].zoneId;
+  }
+  return -1;
+}
+
+static bool isLive(int zoneId)
+{
+  return zoneId >= 0 && zoneId < zoneCount && localNameLengths[zoneId] != 0;
+}
+
+static void insertIndex(int zoneId)
+{
+  uint32_t hash = hashZoneName(zoneNames[zoneId]);
+  int position = lowerBound(hash);
+  memmove(&zoneIndex[position + 1], &zoneIndex[position], (indexCount - position) * sizeof(ZoneIndexEntry));
+  zoneIndex[position].hash = hash;
+  zoneIndex[position].zoneId = zoneId;
+  indexCount++;
+}
+
+static void removeIndex(int zoneId)
+{
+  for (int i = lowerBound(hashZoneName(zoneNames[zoneId])); i < indexCount; i++)
+  {
+    if (zoneIndex[i].zoneId == zoneId)
+    {
+      memmove(&zoneIndex[i], &zoneIndex[i + 1], (indexCount - i - 1) * sizeof(ZoneIndexEntry));
+      indexCount--;
+      return;
+    }
+  }
+}
+
+// Formats the public name used when another hub already has localName
+static bool qualifiedName(uint8_t hub, const char *localName, char *out)
+{
+  int length = snprintf(out, MAX_ZONE_NAME, "%s (%u)", localName, (unsigned)hub + 1);
+  return length > 0 && length < MAX_ZONE_NAME;
+}
+
+int findHubZone(uint8_t hub, const char *localName)
+{
+  size_t localLength = strlen(localName);
+  int zoneId = findZone(localName);
+  if (zoneId >= 0 && zoneHubs[zoneId] == hub && localNameLengths[zoneId] == localLength)
+    return zoneId;
+
+  char qualified[MAX_ZONE_NAME];
+  if (!qualifiedName(hub, localName, qualified))
+    return -1;
+  zoneId = findZone(qualified);
+  if (zoneId >= 0 && zoneHubs[zoneId] == hub && localNameLengths[zoneId] == localLength)
+    return zoneId;
+  return -1;
+}
+
+// Picks the public name for a hub's zone, qualifying it if another zone has it
+static bool publicName(uint8_t hub, const char *localName, char *out)
+{
+  if (findZone(localName) < 0)
+  {
+    strcpy(out, localName);
+    return true;
+  }
+  return qualifiedName(hub, localName, out) && findZone(out) < 0;
+}
+
+int addHubZone(uint8_t hub, const char *localName)
+{
+  int existing = findHubZone(hub, localName);
+  if (existing >= 0)
+    return existing;
+
+  size_t localLength = strlen(localName);
+  if (localLength == 0 || localLength >= MAX_ZONE_NAME)
+    return -1;
+
+  // Reuse the first slot freed by a removed zone
+  int zoneId = 0;
+  while (zoneId < zoneCount && localNameLengths[zoneId] != 0)
+    zoneId++;
+  if (zoneId >= MAX_ZONES || !publicName(hub, localName, zoneNames[zoneId]))
+    return -1;
+
+  zoneHubs[zoneId] = hub;
+  localNameLengths[zoneId] = localLength;
+  zoneDeviceIds[zoneId] = 0;
+  zoneFlags[zoneId] = 0;
+  if (zoneId == zoneCount)
+    zoneCount++;
+  insertIndex(zoneId);
+  catalogGeneration++;
+
+  return zoneId;
+}
+
+bool renameZone(int zoneId, const char *localName)
+{
+  size_t localLength = strlen(localName);
+  if (!isLive(zoneId) || localLength == 0 || localLength >= MAX_ZONE_NAME)
+    return false;
+
+  int existing = findHubZone(zoneHubs[zoneId], localName);
+  if (existing >= 0)
+    return existing == zoneId;
+
+  char name[MAX_ZONE_NAME];
+  removeIndex(zoneId);
+  if (!publicName(zoneHubs[zoneId], localName, name))
+  {
+    insertIndex(zoneId);
+    return false;
+  }
+
+  strcpy(zoneNames[zoneId], name);
+  localNameLengths[zoneId] = localLength;
+  insertIndex(zoneId);
+  catalogGeneration++;
+  return true;
+}
+
+void removeZone(int zoneId)
+{
+  if (!isLive(zoneId))
+    return;
+
+  removeIndex(zoneId);
+  zoneNames[zoneId][0] = '\0';
+  localNameLengths[zoneId] = 0;
+  zoneFlags[zoneId] = 0;
+  while (zoneCount > 0 && localNameLengths[zoneCount - 1] == 0)
+    zoneCount--;
+  catalogGeneration++;
+}
+
+void setZoneDeviceId(int zoneId, uint16_t deviceId)
+{
+  if (isLive(zoneId) && zoneDeviceIds[zoneId] != deviceId)
+  {
+    zoneDeviceIds[zoneId] = deviceId;
+    catalogGeneration++;
+  }
+}
+
+uint16_t getZoneDeviceId(int zoneId)
+{
+  return isLive(zoneId) ? zoneDeviceIds[zoneId] : 0;
+}
+
+const char *getZoneName(int zoneId)
+{
+  return isLive(zoneId) ? zoneNames[zoneId] : nullptr;
+}
+
+bool getZoneState(int zoneId, ZoneState &state)
+{
+  if (!isLive(zoneId) || !(zoneFlags[zoneId] & ZONE_HAS_READING))
+    return false;
+
+  state.actualTemp = actualTemps[zoneId];
+  state.setTemp = setTemps[zoneId];
+  state.flags = zoneFlags[zoneId];
+  state.updatedAt = updatedAts[zoneId];
+  return true;
+}
+
+bool setZoneState(int zoneId, const ZoneState &state)
+{
+  if (!isLive(zoneId))
+    return false;
+
+  bool changed = actualTemps[zoneId] != state.actualTemp || setTemps[zoneId] != state.setTemp ||
+                 zoneFlags[zoneId] != state.flags;
+  actualTemps[zoneId] = state.actualTemp;
+  setTemps[zoneId] = state.setTemp;
+  zoneFlags[zoneId] = state.flags;
+  updatedAts[zoneId] = state.updatedAt;
+  return changed;
+}
+
+uint8_t getZoneHub(int zoneId)
+{
+  return isLive(zoneId) ? zoneHubs[zoneId] : 0;
+}
+
+bool copyZoneLocalName(int zoneId, char *out, size_t size)
+{
+  if (!isLive(zoneId) || localNameLengths[zoneId] >= size)
+    return false;
+
+  memcpy(out, zoneNames[zoneId], localNameLengths[zoneId]);
+  out[localNameLengths[zoneId]] = '\0';
+  return true;
+}
+
+int getZoneCount()
+{
+  return zoneCount;
+}
+
+uint32_t getZoneCatalogGeneration()
+{
+  return catalogGeneration;
+}
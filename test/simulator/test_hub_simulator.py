@@ -0,0 +1,158 @@
+# Host tests for the hub simulator and the load generator:
+#   pip install websockets
+#   python -m unittest discover -s test/simulator
+
+import asyncio
+import http.server
+import json
+import os
+import sys
+import threading
+import time
+import unittest
+
+sys.path.insert(0, os.path.join(os.path.dirname(__file__), "..", "..", "scripts"))
+
+import websockets  # noqa: E402
+
+import hub_simulator  # noqa: E402
+import load_generator  # noqa: E402
+
+API_KEY = "0b4d1d2c-3a5e-4f60-9b7a-1c2d3e4f5a6b"
+
+
+def command_frame(commands, token=API_KEY):
+    """A frame as CommandEncoder writes it: (COMMAND, COMMANDID) pairs"""
+    message = {"token": token, "COMMANDS": [{"COMMAND": text, "COMMANDID": command_id} for text, command_id in commands]}
+    return json.dumps({"message_type": "hm_get_command_queue", "message": json.dumps(message)})
+
+
+class HubSimulatorTest(unittest.IsolatedAsyncioTestCase):
+    async def start(self, **options):
+        self.simulator = hub_simulator.HubSimulator(seed=1, token=API_KEY, **options)
+        self.server = await hub_simulator.serve(self.simulator, "127.0.0.1", 0)
+        port = next(iter(self.server.sockets)).getsockname()[1]
+        self.hub = await websockets.connect("ws://127.0.0.1:%d/" % port)
+
+    async def asyncTearDown(self):
+        await self.hub.close()
+        self.server.close()
+        await self.server.wait_closed()
+
+    async def replies(self, count):
+        replies = []
+        for _ in range(count):
+            reply = json.loads(await asyncio.wait_for(self.hub.recv(), 5))
+            self.assertEqual("hm_set_command_response", reply["message_type"])
+            replies.append((reply["command_id"], json.loads(reply["response"])))
+        return replies
+
+    async def test_get_zones_lists_every_zone_with_its_device_number(self):
+        await self.start(zones=3)
+        await self.hub.send(command_frame([("{'GET_ZONES': 1}", 7)]))
+        self.assertEqual([(7, {"Zone 1": 1, "Zone 2": 2, "Zone 3": 3})], await self.replies(1))
+
+    async def test_get_live_data_reports_each_device(self):
+        await self.start(zones=50)
+        await self.hub.send(command_frame([("{'GET_LIVE_DATA':1}", 8)]))
+        (command_id, response), = await self.replies(1)
+        self.assertEqual(8, command_id)
+        self.assertEqual(50, len(response["devices"]))
+        self.assertEqual("Zone 50", response["devices"][-1]["ZONE_NAME"])
+        float(response["devices"][0]["ACTUAL_TEMP"])
+
+    async def test_batched_commands_are_answered_in_order(self):
+        await self.start(zones=2)
+        self.simulator.zones["Kid's Room"] = hub_simulator.Zone("Kid's Room", 3, 19.0, 20.0)
+        await self.hub.send(command_frame([
+            ("{'SET_TEMP': [21.5,'Zone 1']}", 10),
+            ("{'FROST_ON':['Kid\\'s Room']}", 11),
+            ("{'FROST_OFF':['Zone 2']}", 12),
+            ("{'SET_TEMP': [21.0,'Attic']}", 13),
+        ]))
+        replies = await self.replies(4)
+
+        self.assertEqual([10, 11, 12, 13], [command_id for command_id, _ in replies])
+        self.assertEqual({"result": "temperature was set"}, replies[0][1])
+        self.assertEqual({"result": "frost on"}, replies[1][1])
+        self.assertEqual({"result": "frost off"}, replies[2][1])
+        self.assertIn("error", replies[3][1])
+        self.assertEqual(21.5, self.simulator.zones["Zone 1"].set_temp)
+        self.assertTrue(self.simulator.zones["Kid's Room"].standby)
+
+    async def test_replies_wait_for_the_configured_delay(self):
+        await self.start(zones=2, delay=0.01, live_data_delay=0.15)
+        started = time.monotonic()
+        await self.hub.send(command_frame([("{'GET_ZONES': 1}", 1)]))
+        await self.replies(1)
+        zones_time = time.monotonic() - started
+
+        started = time.monotonic()
+        await self.hub.send(command_frame([("{'GET_LIVE_DATA':1}", 2)]))
+        await self.replies(1)
+        live_data_time = time.monotonic() - started
+
+        self.assertGreaterEqual(zones_time, 0.01)
+        self.assertGreaterEqual(live_data_time, 0.15)
+        self.assertLess(zones_time, live_data_time)
+
+    async def test_wrong_token_is_rejected(self):
+        await self.start(zones=1)
+        await self.hub.send(command_frame([("{'GET_ZONES': 1}", 1)], token="wrong"))
+        reply = json.loads(await asyncio.wait_for(self.hub.recv(), 5))
+        self.assertIn("error", json.loads(reply["response"]))
+
+
+class FakeBridgeHandler(http.server.BaseHTTPRequestHandler):
+    def do_GET(self):
+        if self.path == "/zones":
+            body = json.dumps({"zones": [{"zone": "Zone 1", "temperature": 20.5}, {"zone": "Kid's Room", "temperature": 19}]})
+        elif self.path.startswith("/get_temp/"):
+            body = "20.5"
+        else:
+            self.send_error(404)
+            return
+        self.send_response(200)
+        self.send_header("Content-Length", str(len(body)))
+        self.end_headers()
+        self.wfile.write(body.encode())
+
+    def log_message(self, *args):
+        pass
+
+
+class LoadGeneratorTest(unittest.TestCase):
+    def setUp(self):
+        self.bridge = http.server.ThreadingHTTPServer(("127.0.0.1", 0), FakeBridgeHandler)
+        threading.Thread(target=self.bridge.serve_forever, daemon=True).start()
+        self.port = self.bridge.server_address[1]
+
+    def tearDown(self):
+        self.bridge.shutdown()
+        self.bridge.server_close()
+
+    def test_percentiles_use_the_nearest_rank(self):
+        samples = list(range(1, 101))
+        self.assertEqual(50, load_generator.percentile(samples, 0.50))
+        self.assertEqual(99, load_generator.percentile(samples, 0.99))
+        self.assertEqual(7, load_generator.percentile([7], 0.99))
+
+    def test_runs_the_requested_number_of_requests(self):
+        zones = load_generator.discover_zones("127.0.0.1", self.port, 5)
+        self.assertEqual(["Zone 1", "Kid's Room"], zones)
+
+        mix = {"/zones": 1, "/get_temp/{zone}": 3, "/missing": 1}
+        generator = load_generator.LoadGenerator("127.0.0.1", self.port, zones, mix, seed=3)
+        elapsed = generator.run(duration=30, concurrency=4, total=200)
+
+        counted = sum(len(stats.latencies) + stats.errors for stats in generator.stats.values())
+        self.assertEqual(200, counted)
+        self.assertEqual(0, sum(stats.errors for stats in generator.stats.values()))
+        self.assertEqual({404}, set(generator.stats["/missing"].statuses))
+        summary = generator.summary(elapsed)
+        self.assertIn("p99 ms", summary)
+        self.assertRegex(summary.splitlines()[-1], r"^all\s+200\s+0\s")
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,120 @@
+# Shows what TLS session resumption saves on a hub reconnect, against the
+# simulator serving TLS like a real hub. The bridge resumes the same way
+# through lib/ResumableWebSockets and counts hits in
+# bridge_tls_session_offers_total.
+#   pip install websockets
+#   python -m unittest discover -s test/simulator
+# Needs the openssl command line tool for the throwaway certificate.
+
+import asyncio
+import base64
+import os
+import shutil
+import socket
+import ssl
+import statistics
+import subprocess
+import sys
+import tempfile
+import time
+import unittest
+
+sys.path.insert(0, os.path.join(os.path.dirname(__file__), "..", "..", "scripts"))
+
+import hub_simulator  # noqa: E402
+
+HANDSHAKES = 15
+
+
+def make_certificate(directory):
+    certfile = os.path.join(directory, "hub.pem")
+    keyfile = os.path.join(directory, "hub.key")
+    subprocess.run(["openssl", "req", "-x509", "-newkey", "rsa:2048", "-nodes", "-days", "1",
+                    "-subj", "/CN=neohub", "-addext", "subjectAltName=IP:127.0.0.1",
+                    "-keyout", keyfile, "-out", certfile],
+                   check=True, stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+    return certfile, keyfile
+
+
+def connect(port, context, session=None):
+    """Opens a TLS connection and upgrades it to a websocket like the bridge
+    does. Returns (handshake seconds, client CPU seconds, session, reused)."""
+    raw = socket.create_connection(("127.0.0.1", port), timeout=5)
+    tls = context.wrap_socket(raw, server_hostname="127.0.0.1", session=session, do_handshake_on_connect=False)
+    try:
+        started = time.perf_counter()
+        cpu_started = time.thread_time()
+        tls.do_handshake()
+        cpu = time.thread_time() - cpu_started
+        elapsed = time.perf_counter() - started
+
+        # The hub must still answer the upgrade over a resumed session
+        key = base64.b64encode(os.urandom(16)).decode()
+        tls.sendall(("GET / HTTP/1.1\r\nHost: 127.0.0.1\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+                     "Sec-WebSocket-Key: %s\r\nSec-WebSocket-Version: 13\r\n\r\n" % key).encode())
+        reply = b""
+        while b"\r\n\r\n" not in reply:
+            chunk = tls.recv(1024)
+            if not chunk:
+                break
+            reply += chunk
+        if not reply.startswith(b"HTTP/1.1 101"):
+            raise AssertionError("upgrade failed: %r" % reply[:64])
+        return elapsed, cpu, tls.session, tls.session_reused
+    finally:
+        tls.close()
+
+
+@unittest.skipUnless(shutil.which("openssl"), "needs the openssl tool to make a certificate")
+class TlsResumptionTest(unittest.IsolatedAsyncioTestCase):
+    @classmethod
+    def setUpClass(cls):
+        cls.directory = tempfile.TemporaryDirectory()
+        cls.certfile, cls.keyfile = make_certificate(cls.directory.name)
+
+    @classmethod
+    def tearDownClass(cls):
+        cls.directory.cleanup()
+
+    async def asyncSetUp(self):
+        simulator = hub_simulator.HubSimulator(zones=4)
+        self.server = await hub_simulator.serve(simulator, "127.0.0.1", 0,
+                                                hub_simulator.server_ssl_context(self.certfile, self.keyfile))
+        self.port = next(iter(self.server.sockets)).getsockname()[1]
+
+        # TLS 1.2 like the ESP32 client; its session can be resumed at once,
+        # without waiting for a post-handshake ticket
+        self.context = ssl.SSLContext(ssl.PROTOCOL_TLS_CLIENT)
+        self.context.maximum_version = ssl.TLSVersion.TLSv1_2
+        self.context.load_verify_locations(self.certfile)
+
+    async def asyncTearDown(self):
+        self.server.close()
+        await self.server.wait_closed()
+
+    async def test_resumed_handshake_is_cheaper(self):
+        full = []
+        resumed = []
+        for _ in range(HANDSHAKES):
+            elapsed, cpu, session, reused = await asyncio.to_thread(connect, self.port, self.context)
+            self.assertFalse(reused)
+            full.append((elapsed, cpu))
+
+            elapsed, cpu, _, reused = await asyncio.to_thread(connect, self.port, self.context, session)
+            self.assertTrue(reused, "the simulator did not resume the session")
+            resumed.append((elapsed, cpu))
+
+        def median(samples, index):
+            return statistics.median(sample[index] for sample in samples) * 1000
+
+        print("\n%-24s %10s %14s" % ("handshake", "wall ms", "client cpu ms"))
+        print("%-24s %10.2f %14.2f" % ("full", median(full, 0), median(full, 1)))
+        print("%-24s %10.2f %14.2f" % ("resumed", median(resumed, 0), median(resumed, 1)))
+
+        # A resumed handshake skips the certificate check and key exchange
+        self.assertLess(median(resumed, 1), median(full, 1))
+        self.assertLess(median(resumed, 0), median(full, 0))
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,137 @@
+// Host stand-in for the parts of the Arduino core the portable modules and
+// the native tests use. Only behaviour the bridge relies on is modelled.
+#ifndef STUB_ARDUINO_H
+#define STUB_ARDUINO_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <string>
+#include <thread>
+
+using std::max;
+using std::min;
+
+#define PROGMEM
+#define PGM_P const char *
+#define RTC_NOINIT_ATTR
+
+inline unsigned long micros()
+{
+    static const auto start = std::chrono::steady_clock::now();
+    return (unsigned long)std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now() - start)
+        .count();
+}
+
+inline unsigned long millis()
+{
+    return micros() / 1000;
+}
+
+inline void delay(unsigned long ms)
+{
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+inline void yield() {}
+
+inline int64_t esp_timer_get_time()
+{
+    return micros();
+}
+
+// Heap-backed like the Arduino one, so benchmarks see its allocations
+class String
+{
+public:
+    String() {}
+    String(const char *text) : text(text ? text : "") {}
+    String(const std::string &text) : text(text) {}
+    explicit String(char c) : text(1, c) {}
+    explicit String(int value) : text(std::to_string(value)) {}
+    explicit String(unsigned int value) : text(std::to_string(value)) {}
+    explicit String(long value) : text(std::to_string(value)) {}
+    explicit String(unsigned long value) : text(std::to_string(value)) {}
+    explicit String(double value, unsigned int decimals = 2)
+    {
+        char formatted[32];
+        snprintf(formatted, sizeof(formatted), "%.*f", (int)decimals, value);
+        text = formatted;
+    }
+
+    const char *c_str() const { return text.c_str(); }
+    unsigned int length() const { return text.size(); }
+    char charAt(unsigned int index) const { return index < text.size() ? text[index] : 0; }
+    char operator[](unsigned int index) const { return charAt(index); }
+    bool reserve(unsigned int size)
+    {
+        text.reserve(size);
+        return true;
+    }
+
+    String &operator+=(const String &other)
+    {
+        text += other.text;
+        return *this;
+    }
+    String &operator+=(const char *other)
+    {
+        text += other;
+        return *this;
+    }
+    String &operator+=(char c)
+    {
+        text += c;
+        return *this;
+    }
+
+    bool operator==(const String &other) const { return text == other.text; }
+    bool operator==(const char *other) const { return text == other; }
+    bool operator!=(const String &other) const { return text != other.text; }
+
+    float toFloat() const { return strtof(text.c_str(), nullptr); }
+    long toInt() const { return strtol(text.c_str(), nullptr, 10); }
+
+    String substring(unsigned int from) const { return from < text.size() ? text.substr(from) : std::string(); }
+    String substring(unsigned int from, unsigned int to) const
+    {
+        return from < text.size() && from < to ? text.substr(from, to - from) : std::string();
+    }
+
+private:
+    std::string text;
+};
+
+inline String operator+(const String &left, const String &right)
+{
+    String joined(left);
+    joined += right;
+    return joined;
+}
+
+class HardwareSerial
+{
+public:
+    void begin(unsigned long) {}
+    size_t write(const uint8_t *, size_t length) { return length; } // Log lines are dropped
+};
+inline HardwareSerial Serial;
+
+class EspClass
+{
+public:
+    uint32_t getFreeHeap() { return 0; }
+    uint32_t getMinFreeHeap() { return 0; }
+    uint32_t getMaxAllocHeap() { return 0; }
+};
+inline EspClass ESP;
+
+#endif
@@ -0,0 +1,14 @@
+// Host stand-in; the captive portal never runs on the host
+#ifndef STUB_DNS_SERVER_H
+#define STUB_DNS_SERVER_H
+
+#include <WiFi.h>
+
+class DNSServer
+{
+public:
+    void processNextRequest() {}
+    void stop() {}
+};
+
+#endif
@@ -0,0 +1,33 @@
+// Host stand-in for lib/ResumableWebSockets, which only builds for the
+// ESP32. Sessions are never offered, so every connect is a full handshake.
+#ifndef STUB_RESUMABLE_WEBSOCKETS_CLIENT_H
+#define STUB_RESUMABLE_WEBSOCKETS_CLIENT_H
+
+#include <WebSocketsClient.h>
+
+#define TLS_SESSION_MAX_SIZE 1280
+
+struct TlsSessionSlot
+{
+    uint32_t magic;
+    uint16_t length;
+    unsigned char data[TLS_SESSION_MAX_SIZE];
+};
+
+inline void clearTlsSession(TlsSessionSlot &slot)
+{
+    slot.magic = 0;
+    slot.length = 0;
+}
+
+class ResumableWebSocketsClient : public WebSocketsClient
+{
+public:
+    void setSessionSlot(TlsSessionSlot *slot) { sessionSlot = slot; }
+    bool sessionOffered() const { return false; }
+    bool sessionResumed() const { return false; }
+
+    TlsSessionSlot *sessionSlot = nullptr;
+};
+
+#endif
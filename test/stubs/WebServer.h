@@ -0,0 +1,130 @@
+// Host stand-in for the ESP32 WebServer. Responses are collected in memory
+// instead of being written to a client.
+#ifndef STUB_WEB_SERVER_H
+#define STUB_WEB_SERVER_H
+
+#include <WiFi.h>
+#include <map>
+#include <vector>
+
+#define CONTENT_LENGTH_UNKNOWN ((size_t)-1)
+
+enum HTTPMethod
+{
+    HTTP_ANY,
+    HTTP_GET,
+    HTTP_HEAD,
+    HTTP_POST
+};
+
+enum HTTPClientStatus
+{
+    HC_NONE,
+    HC_WAIT_READ,
+    HC_WAIT_CLOSE
+};
+
+class WebServer;
+
+class RequestHandler
+{
+public:
+    virtual ~RequestHandler() {}
+    virtual bool canHandle(HTTPMethod, String) { return false; }
+    virtual bool handle(WebServer &, HTTPMethod, String) { return false; }
+};
+
+class WebServer
+{
+public:
+    typedef std::function<void()> THandlerFunction;
+
+    explicit WebServer(int port = 80) { (void)port; }
+    virtual ~WebServer()
+    {
+        for (RequestHandler *handler : handlers)
+            delete handler;
+    }
+
+    void begin() {}
+    void handleClient() {}
+
+    void addHandler(RequestHandler *handler) { handlers.push_back(handler); }
+    void on(const String &uri, THandlerFunction handler) { on(uri, HTTP_ANY, handler); }
+    void on(const String &uri, HTTPMethod method, THandlerFunction handler)
+    {
+        addHandler(new FunctionRequestHandler(uri, method, handler));
+    }
+
+    // Walks the handlers in registration order like the real server does for
+    // each request. Returns false if none took it.
+    bool handleRequest(HTTPMethod method, const String &uri)
+    {
+        for (RequestHandler *handler : handlers)
+        {
+            if (handler->canHandle(method, uri) && handler->handle(*this, method, uri))
+                return true;
+        }
+        return false;
+    }
+
+    bool hasArg(const String &name) { return requestArgs.count(name.c_str()) != 0; }
+    String arg(const String &name) { return hasArg(name) ? String(requestArgs[name.c_str()]) : String(); }
+
+    void setContentLength(size_t) {}
+    void sendHeader(const String &, const String &, bool = false) {}
+
+    void send(int code, const char *contentType = nullptr, const String &content = String())
+    {
+        (void)contentType;
+        lastCode = code;
+        body = content.c_str();
+    }
+    void send_P(int code, PGM_P contentType, PGM_P content, size_t length)
+    {
+        (void)contentType;
+        lastCode = code;
+        body.assign(content, length);
+    }
+
+    void sendContent(const char *content, size_t length) { body.append(content, length); }
+    void sendContent(const String &content) { body += content.c_str(); }
+
+    int lastCode = 0;
+    std::string body;
+    std::map<std::string, std::string> requestArgs; // Query arguments of the request being handled
+
+protected:
+    WiFiClient _currentClient;
+    HTTPClientStatus _currentStatus = HC_NONE;
+
+private:
+    // What on() registers: one exact URI
+    class FunctionRequestHandler : public RequestHandler
+    {
+    public:
+        FunctionRequestHandler(const String &uri, HTTPMethod method, THandlerFunction handler)
+            : uri(uri), method(method), handler(handler) {}
+
+        bool canHandle(HTTPMethod requestMethod, String requestUri) override
+        {
+            return (method == HTTP_ANY || method == requestMethod) && requestUri == uri;
+        }
+        bool handle(WebServer &, HTTPMethod requestMethod, String requestUri) override
+        {
+            if (!canHandle(requestMethod, requestUri))
+                return false;
+            handler();
+            return true;
+        }
+
+    private:
+        String uri;
+        HTTPMethod method;
+        THandlerFunction handler;
+    };
+
+    std::vector<RequestHandler *> handlers;
+};
+
+#endif
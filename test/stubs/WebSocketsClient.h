@@ -0,0 +1,54 @@
+// Host stand-in for links2004/WebSockets. Nothing goes on the wire: frames
+// are counted, and events are delivered by calling the handler directly.
+#ifndef STUB_WEBSOCKETS_CLIENT_H
+#define STUB_WEBSOCKETS_CLIENT_H
+
+#include <Arduino.h>
+
+#define WEBSOCKETS_MAX_HEADER_SIZE 14 // Same tokens as command_encoder.h, which defines it too off-device
+
+typedef enum
+{
+    WStype_ERROR,
+    WStype_DISCONNECTED,
+    WStype_CONNECTED,
+    WStype_TEXT,
+    WStype_BIN,
+    WStype_FRAGMENT_TEXT_START,
+    WStype_FRAGMENT_BIN_START,
+    WStype_FRAGMENT,
+    WStype_FRAGMENT_FIN,
+    WStype_PING,
+    WStype_PONG,
+} WStype_t;
+
+class WebSocketsClient
+{
+public:
+    typedef std::function<void(WStype_t type, uint8_t *payload, size_t length)> WebSocketClientEvent;
+
+    void begin(const char *, uint16_t, const char * = "/", const char * = "arduino") {}
+    void beginSSL(const char *, uint16_t, const char * = "/", const char * = "", const char * = "arduino") {}
+    void onEvent(WebSocketClientEvent handler) { this->handler = handler; }
+
+    void loop() {}
+    bool isConnected() { return connected; }
+
+    // headerToPayload: the real library writes the frame header into the
+    // WEBSOCKETS_MAX_HEADER_SIZE bytes in front of payload
+    bool sendTXT(uint8_t *payload, size_t length = 0, bool headerToPayload = false)
+    {
+        (void)payload;
+        (void)headerToPayload;
+        framesSent++;
+        bytesSent += length;
+        return connected;
+    }
+
+    bool connected = true;
+    uint32_t framesSent = 0;
+    size_t bytesSent = 0;
+    WebSocketClientEvent handler;
+};
+
+#endif
@@ -0,0 +1,15 @@
+// Host stand-in: only the client type WebServer hands around
+#ifndef STUB_WIFI_H
+#define STUB_WIFI_H
+
+#include <Arduino.h>
+
+class WiFiClient
+{
+public:
+    bool connected() { return false; }
+    void stop() {}
+    int fd() const { return -1; }
+};
+
+#endif
@@ -0,0 +1,153 @@
+// Timing and heap accounting for the native test suites. Include from exactly
+// one file per suite: on glibc it replaces malloc and friends to count every
+// allocation, including those made through operator new. Sanitizers bring
+// their own allocator, so under -fsanitize=thread or address the counting
+// is compiled out and the zero-allocation checks are skipped.
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <atomic>
+#include <chrono>
+
+#if defined(__SANITIZE_THREAD__) || defined(__SANITIZE_ADDRESS__)
+#define BENCH_SANITIZER 1
+#elif defined(__has_feature)
+#if __has_feature(thread_sanitizer) || __has_feature(address_sanitizer)
+#define BENCH_SANITIZER 1
+#endif
+#endif
+
+#if defined(__GLIBC__) && !defined(BENCH_SANITIZER)
+#include <malloc.h>
+#define BENCH_HEAP_TRACKING 1
+
+extern "C"
+{
+    void *__libc_malloc(size_t size);
+    void *__libc_calloc(size_t count, size_t size);
+    void *__libc_realloc(void *pointer, size_t size);
+    void __libc_free(void *pointer);
+}
+#else
+#define BENCH_HEAP_TRACKING 0
+#endif
+
+struct HeapCounters
+{
+    std::atomic<uint64_t> allocations;
+    std::atomic<int64_t> bytes; // Live bytes, including allocator rounding
+    std::atomic<int64_t> peak;
+};
+
+static HeapCounters heapCounters;
+
+#if BENCH_HEAP_TRACKING
+static void heapGrew(int64_t size)
+{
+    int64_t bytes = heapCounters.bytes.fetch_add(size, std::memory_order_relaxed) + size;
+    int64_t peak = heapCounters.peak.load(std::memory_order_relaxed);
+    while (bytes > peak && !heapCounters.peak.compare_exchange_weak(peak, bytes, std::memory_order_relaxed))
+    {
+    }
+}
+
+extern "C" void *malloc(size_t size)
+{
+    void *pointer = __libc_malloc(size);
+    if (pointer)
+    {
+        heapCounters.allocations.fetch_add(1, std::memory_order_relaxed);
+        heapGrew(malloc_usable_size(pointer));
+    }
+    return pointer;
+}
+
+extern "C" void *calloc(size_t count, size_t size)
+{
+    void *pointer = __libc_calloc(count, size);
+    if (pointer)
+    {
+        heapCounters.allocations.fetch_add(1, std::memory_order_relaxed);
+        heapGrew(malloc_usable_size(pointer));
+    }
+    return pointer;
+}
+
+extern "C" void *realloc(void *pointer, size_t size)
+{
+    size_t before = pointer ? malloc_usable_size(pointer) : 0;
+    void *resized = __libc_realloc(pointer, size);
+    if (resized)
+    {
+        heapCounters.allocations.fetch_add(1, std::memory_order_relaxed);
+        heapGrew((int64_t)malloc_usable_size(resized) - (int64_t)before);
+    }
+    else if (pointer && size == 0)
+    {
+        heapGrew(-(int64_t)before);
+    }
+    return resized;
+}
+
+extern "C" void free(void *pointer)
+{
+    if (pointer)
+        heapGrew(-(int64_t)malloc_usable_size(pointer));
+    __libc_free(pointer);
+}
+#endif
+
+// Counts from here on; peaks are measured against the heap at this point
+static void resetHeapCounters()
+{
+    heapCounters.allocations.store(0, std::memory_order_relaxed);
+    heapCounters.peak.store(heapCounters.bytes.load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
+
+static uint64_t heapAllocations()
+{
+    return heapCounters.allocations.load(std::memory_order_relaxed);
+}
+
+// Highest live heap since the last reset, above what was live at the reset
+static size_t heapPeakGrowth(int64_t baseline)
+{
+    int64_t peak = heapCounters.peak.load(std::memory_order_relaxed);
+    return peak > baseline ? (size_t)(peak - baseline) : 0;
+}
+
+struct BenchResult
+{
+    double nsPerOp;
+    double allocationsPerOp; // -1 where the heap is not tracked
+    size_t peakHeap;         // Bytes above the heap at the start of the run
+};
+
+// Runs body once to warm up, so one-off first-use allocations stay out of the
+// numbers, then iterations times under the clock, and prints one line
+template <typename Body>
+BenchResult runBenchmark(const char *name, uint32_t iterations, Body body)
+{
+    body();
+
+    int64_t baseline = heapCounters.bytes.load(std::memory_order_relaxed);
+    resetHeapCounters();
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < iterations; i++)
+        body();
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    BenchResult result;
+    result.nsPerOp = std::chrono::duration<double, std::nano>(elapsed).count() / iterations;
+    result.allocationsPerOp = BENCH_HEAP_TRACKING ? (double)heapAllocations() / iterations : -1;
+    result.peakHeap = heapPeakGrowth(baseline);
+
+    printf("%-40s %12.1f ns/op %9.2f allocs/op %8zu B peak heap\n", name, result.nsPerOp, result.allocationsPerOp,
+           result.peakHeap);
+    return result;
+}
+
+#endif
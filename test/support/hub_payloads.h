@@ -0,0 +1,76 @@
+// Builds neoHub hm_set_command_response messages like the ones the hub sends,
+// with the inner document escaped into the "response" string
+#ifndef HUB_PAYLOADS_H
+#define HUB_PAYLOADS_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+
+static inline std::string escapeJsonString(const std::string &text)
+{
+    std::string escaped;
+    escaped.reserve(text.size() + text.size() / 4);
+    for (char c : text)
+    {
+        if (c == '"' || c == '\\')
+            escaped += '\\';
+        escaped += c;
+    }
+    return escaped;
+}
+
+static inline std::string commandResponse(uint32_t commandId, const std::string &response)
+{
+    char head[96];
+    snprintf(head, sizeof(head), "{\"command_id\":%lu,\"device_id\":\"NH-BENCH\",\"message_type\":\"hm_set_command_response\",",
+             (unsigned long)commandId);
+    return head + std::string("\"response\":\"") + escapeJsonString(response) + "\"}";
+}
+
+static inline std::string benchZoneName(int index)
+{
+    char name[32];
+    snprintf(name, sizeof(name), "Zone %d \"%s\"", index + 1, index % 2 ? "Upstairs" : "Hall");
+    return name;
+}
+
+// GET_ZONES: zone names mapped to device numbers
+static inline std::string zonesReply(uint32_t commandId, int zones)
+{
+    std::string response = "{";
+    for (int i = 0; i < zones; i++)
+    {
+        char entry[16];
+        snprintf(entry, sizeof(entry), "\":%d", i + 1);
+        response += (i ? ",\"" : "\"") + escapeJsonString(benchZoneName(i)) + entry;
+    }
+    return commandResponse(commandId, response + "}");
+}
+
+// GET_LIVE_DATA with a typical neoStat's worth of fields per device
+static inline std::string liveDataReply(uint32_t commandId, int devices)
+{
+    std::string response = "{\"CLOSE_DELAY\":0,\"COOL_INPUT\":false,\"HOLIDAY_END\":0,\"HUB_AWAY\":false,"
+                            "\"HUB_HOLIDAY\":false,\"HUB_TIME\":1700000000,\"OPEN_DELAY\":0,\"devices\":[";
+    for (int i = 0; i < devices; i++)
+    {
+        char device[1280];
+        snprintf(device, sizeof(device),
+                 "%s{\"ACTIVE_LEVEL\":0,\"ACTIVE_PROFILE\":0,\"ACTUAL_TEMP\":\"%.1f\",\"AVAILABLE_MODES\":[\"heat\"],"
+                 "\"AWAY\":false,\"COOL_ON\":false,\"COOL_TEMP\":0,\"CURRENT_FLOOR_TEMPERATURE\":127,\"DATE\":\"Monday\","
+                 "\"DEVICE_ID\":%d,\"FAN_CONTROL\":\"Manual\",\"FAN_SPEED\":\"Off\",\"FLOOR_LIMIT\":false,\"HC_MODE\":\"HEATING\","
+                 "\"HEAT_MODE\":true,\"HEAT_ON\":%s,\"HOLD_COOL\":0,\"HOLD_OFF\":false,\"HOLD_ON\":false,\"HOLD_TEMP\":20,"
+                 "\"HOLD_TIME\":\"0:00\",\"HOLIDAY\":false,\"HUMIDITY\":0,\"LOCK\":false,\"LOCK_PIN_NUMBER\":\"0000\","
+                 "\"LOW_BATTERY\":false,\"MODELOCK\":false,\"MODULATION_LEVEL\":0,\"OFFLINE\":false,\"PIN_NUMBER\":\"0000\","
+                 "\"PREHEAT_ACTIVE\":false,\"PRG_TEMP\":0,\"PRG_TIMER\":false,\"SET_TEMP\":\"%.1f\",\"STANDBY\":false,"
+                 "\"SWITCH_DELAY_LEFT\":\"0:00\",\"TEMPORARY_SET_FLAG\":false,\"THERMOSTAT\":true,\"TIME\":\"12:00\","
+                 "\"TIMER_ON\":false,\"WINDOW_OPEN\":false,\"WRITE_COUNT\":%d,\"ZONE_NAME\":\"%s\"}",
+                 i ? "," : "", 18.0 + (i % 50) / 10.0, i + 1, i % 3 ? "false" : "true", 20.0 + (i % 4) / 2.0, i,
+                 escapeJsonString(benchZoneName(i)).c_str());
+        response += device;
+    }
+    return commandResponse(commandId, response + "]}");
+}
+
+#endif
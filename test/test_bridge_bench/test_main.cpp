@@ -0,0 +1,239 @@
+// Micro-benchmarks for the hub message and command paths:
+//   pio test -e native -f test_bridge_bench -v
+// Each benchmark prints ns/op, heap allocations per op and peak heap growth.
+// The paths that must stay off the heap also fail the test if they allocate.
+#include <unity.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "../support/bench.h"
+#include "../support/hub_payloads.h"
+
+// These modules reach into the hub task, config and metrics, which are faked
+// below, so they are built here rather than through build_src_filter
+#include "../../src/command_tracker.cpp"
+#include "../../src/websockets.cpp"
+#include "../../src/websockets_commands.cpp"
+
+#include "spsc_queue.h"
+
+static SpscQueue<HubCommand, HUB_COMMAND_QUEUE_SIZE> commandQueue;
+static uint32_t eventsPosted = 0;
+static uint32_t readingsPosted = 0;
+static HubEvent lastEvent;
+
+bool postHubCommand(uint8_t, const HubCommand &command)
+{
+  return commandQueue.push(command);
+}
+
+bool takeHubCommand(uint8_t, HubCommand &command)
+{
+  return commandQueue.pop(command);
+}
+
+void postHubEvent(uint8_t, HubEventType type, uint32_t value, CommandStatus status, const char *)
+{
+  eventsPosted++;
+  lastEvent.type = type;
+  lastEvent.value = value;
+  lastEvent.status = status;
+}
+
+void postHubReading(uint8_t, const LiveDeviceData &)
+{
+  readingsPosted++;
+}
+
+void postHubConnectTime(uint8_t, uint32_t, bool, uint8_t) {}
+
+uint8_t getHubCount()
+{
+  return 1;
+}
+
+const char *getHubAddress(uint8_t)
+{
+  return "127.0.0.1";
+}
+
+const char *getHubApiKey(uint8_t)
+{
+  return "0b4d1d2c-3a5e-4f60-9b7a-1c2d3e4f5a6b";
+}
+
+void recordCommandRoundTrip(CommandType, uint32_t) {}
+void recordCommandTimeout(CommandType) {}
+
+#define BENCH_ITERATIONS 2000
+
+static uint32_t zonesCommandId = 0;
+static uint32_t liveDataCommandId = 0;
+static int benchZoneId = -1;
+
+// Sends one queued command the way the hub task would and returns its ID
+static uint32_t sendQueued(uint32_t commandId)
+{
+  serviceCommandQueue(0);
+  flushCommands(0);
+  return commandId;
+}
+
+static void assertOffHeap(const BenchResult &result)
+{
+#if BENCH_HEAP_TRACKING
+  TEST_ASSERT_EQUAL_FLOAT(0, result.allocationsPerOp);
+#else
+  (void)result;
+#endif
+}
+
+void setUp() {}
+void tearDown() {}
+
+static void test_handle_zones_reply()
+{
+  static const int sizes[] = {4, 8, 16, 24};
+  for (int zones : sizes)
+  {
+    std::string reply = zonesReply(zonesCommandId, zones);
+    std::vector<uint8_t> payload(reply.size() + 1);
+
+    char name[64];
+    snprintf(name, sizeof(name), "handleWebSocketMessage zones=%d (%zuB)", zones, reply.size());
+    eventsPosted = 0;
+    BenchResult result = runBenchmark(name, BENCH_ITERATIONS, [&]()
+                                      {
+      // GET_ZONES replies are unescaped in place, so each run gets a fresh copy
+      memcpy(payload.data(), reply.c_str(), reply.size() + 1);
+      handleWebSocketMessage(0, payload.data(), reply.size()); });
+
+    // One event per zone plus the reply, for the warm-up run and every iteration
+    TEST_ASSERT_EQUAL_UINT32((uint32_t)(zones + 1) * (BENCH_ITERATIONS + 1), eventsPosted);
+    assertOffHeap(result);
+  }
+}
+
+static void test_handle_live_data_reply()
+{
+  static const int sizes[] = {10, 50, 200};
+  for (int devices : sizes)
+  {
+    std::string reply = liveDataReply(liveDataCommandId, devices);
+    std::vector<uint8_t> payload(reply.begin(), reply.end());
+
+    char name[64];
+    snprintf(name, sizeof(name), "handleWebSocketMessage live=%d (%zuB)", devices, reply.size());
+    readingsPosted = 0;
+    BenchResult result = runBenchmark(name, devices >= 200 ? BENCH_ITERATIONS / 10 : BENCH_ITERATIONS, [&]()
+                                      { handleWebSocketMessage(0, payload.data(), payload.size()); });
+
+    TEST_ASSERT_EQUAL_UINT32(0, readingsPosted % devices);
+    TEST_ASSERT_TRUE(readingsPosted > 0);
+    assertOffHeap(result);
+  }
+}
+
+static void test_url_encode()
+{
+  String plain("LivingRoom");
+  String spaced("Kid's Room & Landing (1st floor)");
+  size_t length = 0;
+
+  runBenchmark("urlEncode plain", BENCH_ITERATIONS * 10, [&]()
+               { length += urlEncode(plain).length(); });
+  runBenchmark("urlEncode spaces+symbols", BENCH_ITERATIONS * 10, [&]()
+               { length += urlEncode(spaced).length(); });
+
+  TEST_ASSERT_EQUAL_STRING("Kid%27s+Room+%26+Landing+%281st+floor%29", urlEncode(spaced).c_str());
+  TEST_ASSERT_TRUE(length > 0);
+}
+
+static void test_extract_value()
+{
+  std::string reply = commandResponse(42, "{\"result\":\"temperature was set\"}");
+  size_t length = 0;
+
+  runBenchmark("extractValue command_id", BENCH_ITERATIONS * 10, [&]()
+               { length += extractValue(reply.c_str(), "command_id").length(); });
+  runBenchmark("extractValue message_type", BENCH_ITERATIONS * 10, [&]()
+               { length += extractValue(reply.c_str(), "message_type").length(); });
+
+  TEST_ASSERT_EQUAL_STRING("42", extractValue(reply.c_str(), "command_id").c_str());
+  TEST_ASSERT_EQUAL_STRING("hm_set_command_response", extractValue(reply.c_str(), "message_type").c_str());
+  TEST_ASSERT_TRUE(length > 0);
+}
+
+// Replies to one SET_TEMP command and checks the status handed to the loop() core
+static void assertSetTempReply(const char *response, CommandStatus expected)
+{
+  uint32_t commandId = sendQueued(sendSetTemperatureCommand(benchZoneId, 19.0f));
+  std::string reply = commandResponse(commandId, response);
+  std::vector<uint8_t> payload(reply.begin(), reply.end());
+
+  lastEvent = HubEvent();
+  handleWebSocketMessage(0, payload.data(), payload.size());
+  completeCommand(commandId, COMMAND_OK);
+
+  TEST_ASSERT_EQUAL(HUB_EVENT_REPLY, lastEvent.type);
+  TEST_ASSERT_EQUAL_UINT32(commandId, lastEvent.value);
+  TEST_ASSERT_EQUAL(expected, lastEvent.status);
+}
+
+static void test_command_reply_status()
+{
+  assertSetTempReply("{\"result\":\"temperature was set\"}", COMMAND_OK);
+  assertSetTempReply("{\"error\":\"Could not find zone\"}", COMMAND_FAILED);
+
+  // Only an "error" key counts, not the word anywhere in the frame
+  assertSetTempReply("{\"result\":\"set for error-prone attic\"}", COMMAND_OK);
+  assertSetTempReply("not json", COMMAND_FAILED);
+}
+
+// Queue, encode and send one command, then settle it so its slot frees up
+template <typename Send>
+static BenchResult benchCommand(const char *name, Send send)
+{
+  return runBenchmark(name, BENCH_ITERATIONS * 5, [&]()
+                      {
+    uint32_t commandId = sendQueued(send());
+    TEST_ASSERT_NOT_EQUAL(0, commandId);
+    completeCommand(commandId, COMMAND_OK); });
+}
+
+static void test_send_commands()
+{
+  uint32_t framesBefore = hubSockets[0].framesSent;
+
+  assertOffHeap(benchCommand("sendGetZonesCommand", []()
+                             { return sendGetZonesCommand(0); }));
+  assertOffHeap(benchCommand("sendGetTemperatureCommand", []()
+                             { return sendGetTemperatureCommand(0); }));
+  assertOffHeap(benchCommand("sendSetTemperatureCommand", []()
+                             { return sendSetTemperatureCommand(benchZoneId, 21.5f); }));
+  assertOffHeap(benchCommand("sendStandbyCommand", []()
+                             { return sendStandbyCommand(benchZoneId, true); }));
+
+  // One frame per command, warm-up runs included
+  TEST_ASSERT_EQUAL_UINT32(4 * (BENCH_ITERATIONS * 5 + 1), hubSockets[0].framesSent - framesBefore);
+}
+
+int main()
+{
+  reserveJsonArenas(1);
+  benchZoneId = addHubZone(0, "Living Room \"Main\"");
+
+  // Replies are only routed for commands the pipeline has sent; these two
+  // stay pending for the whole run so their IDs keep resolving
+  zonesCommandId = sendQueued(sendGetZonesCommand(0));
+  liveDataCommandId = sendQueued(sendGetTemperatureCommand(0));
+
+  UNITY_BEGIN();
+  RUN_TEST(test_handle_zones_reply);
+  RUN_TEST(test_handle_live_data_reply);
+  RUN_TEST(test_url_encode);
+  RUN_TEST(test_extract_value);
+  RUN_TEST(test_send_commands);
+  RUN_TEST(test_command_reply_status);
+  return UNITY_END();
+}
@@ -0,0 +1,181 @@
+// Command encoder tests and benchmarks:
+//   pio test -e native -f test_command_encoder -v
+// Compares bytes copied and time per command with the two-document
+// ArduinoJson builder the encoder replaced, and checks zone names survive
+// both levels of escaping.
+#include <unity.h>
+#include <string.h>
+#include <ArduinoJson.h>
+#include "../support/bench.h"
+#include "command_encoder.h"
+
+#define BENCH_ITERATIONS 20000
+
+static const char *const apiKey = "0b4d1d2c-3a5e-4f60-9b7a-1c2d3e4f5a6b";
+
+struct LegacyFrame
+{
+  String frame;
+  size_t bytesCopied; // Every byte written into an intermediate or final buffer
+};
+
+// The old send*Command body: the command text spliced into a String, the
+// inner document serialized to a String, embedded in the outer one and
+// serialized again. Zone names were not escaped.
+static LegacyFrame legacyFrame(const String &commandString, uint32_t commandId, bool ownedCommand)
+{
+  LegacyFrame legacy;
+  legacy.bytesCopied = 0;
+
+  StaticJsonDocument<256> innerDoc;
+  innerDoc["token"] = apiKey;
+  JsonArray commands = innerDoc.createNestedArray("COMMANDS");
+  JsonObject commandObj = commands.createNestedObject();
+  if (ownedCommand)
+  {
+    // Built by concatenation, then copied into the document
+    commandObj["COMMAND"] = commandString;
+    legacy.bytesCopied += commandString.length() * 2;
+  }
+  else
+  {
+    commandObj["COMMAND"] = commandString.c_str();
+  }
+  commandObj["COMMANDID"] = commandId;
+
+  String innerMessage;
+  serializeJson(innerDoc, innerMessage);
+
+  StaticJsonDocument<256> outerDoc;
+  outerDoc["message_type"] = "hm_get_command_queue";
+  outerDoc["message"] = innerMessage;
+  legacy.bytesCopied += innerMessage.length() * 2;
+
+  serializeJson(outerDoc, legacy.frame);
+  legacy.bytesCopied += legacy.frame.length();
+  return legacy;
+}
+
+static LegacyFrame legacySetTemp(uint32_t commandId, const String &zone, float temperature)
+{
+  String commandString = "{'SET_TEMP': [" + String(temperature, 1) + ",'" + zone + "']}";
+  return legacyFrame(commandString, commandId, true);
+}
+
+static LegacyFrame legacyGetLiveData(uint32_t commandId)
+{
+  return legacyFrame("{'GET_LIVE_DATA':1}", commandId, false);
+}
+
+static CommandEncoder encoder;
+
+static String encoded()
+{
+  return String(std::string((const char *)encoder.payload(), encoder.length()));
+}
+
+// Unwraps a frame the way the hub does and checks its first COMMAND string
+static void assertFirstCommand(const char *expected, const String &frame)
+{
+  DynamicJsonDocument outer(2048);
+  TEST_ASSERT_FALSE(deserializeJson(outer, frame.c_str()));
+  TEST_ASSERT_EQUAL_STRING("hm_get_command_queue", outer["message_type"].as<const char *>());
+
+  DynamicJsonDocument inner(2048);
+  TEST_ASSERT_FALSE(deserializeJson(inner, outer["message"].as<const char *>()));
+  TEST_ASSERT_EQUAL_STRING(apiKey, inner["token"].as<const char *>());
+  TEST_ASSERT_EQUAL_STRING(expected, inner["COMMANDS"][0]["COMMAND"].as<const char *>());
+}
+
+void setUp() {}
+void tearDown() {}
+
+static void test_matches_legacy_frames()
+{
+  encoder.begin(apiKey);
+  TEST_ASSERT_TRUE(encoder.addSetTemp(7, "Living Room", 20.0f));
+  TEST_ASSERT_TRUE(encoder.finish());
+  TEST_ASSERT_EQUAL_STRING(legacySetTemp(7, "Living Room", 20.0f).frame.c_str(), encoded().c_str());
+
+  encoder.begin(apiKey);
+  TEST_ASSERT_TRUE(encoder.addGetLiveData(16777218));
+  TEST_ASSERT_TRUE(encoder.finish());
+  TEST_ASSERT_EQUAL_STRING(legacyGetLiveData(16777218).frame.c_str(), encoded().c_str());
+}
+
+static void test_escapes_zone_names()
+{
+  encoder.begin(apiKey);
+  TEST_ASSERT_TRUE(encoder.addSetTemp(3, "Kid's \"Den\" \\ Attic", 21.5f));
+  TEST_ASSERT_TRUE(encoder.finish());
+  assertFirstCommand("{'SET_TEMP': [21.5,'Kid\\'s \"Den\" \\\\ Attic']}", encoded());
+
+  encoder.begin(apiKey);
+  TEST_ASSERT_TRUE(encoder.addFrost(4, "Kid's Room", true));
+  TEST_ASSERT_TRUE(encoder.finish());
+  assertFirstCommand("{'FROST_ON':['Kid\\'s Room']}", encoded());
+}
+
+static void test_rolls_back_commands_that_do_not_fit()
+{
+  encoder.begin(apiKey);
+  uint8_t added = 0;
+  while (encoder.addSetTemp(added + 1, "Living Room", 20.0f))
+    added++;
+
+  TEST_ASSERT_TRUE(added > 1);
+  TEST_ASSERT_EQUAL_UINT8(added, encoder.commandCount());
+  TEST_ASSERT_TRUE(encoder.finish());
+  TEST_ASSERT_TRUE(encoder.length() <= COMMAND_FRAME_SIZE);
+  assertFirstCommand("{'SET_TEMP': [20.0,'Living Room']}", encoded());
+}
+
+// Prints one bytes-copied line; the encoder writes each frame byte once
+static void compareBytes(const char *name, size_t legacyBytes)
+{
+  printf("%-40s %12zu B copied (legacy %zu B)\n", name, encoder.length(), legacyBytes);
+  TEST_ASSERT_LESS_THAN(legacyBytes, encoder.length());
+}
+
+static void test_bytes_copied_and_time_per_command()
+{
+  String zone("Living Room");
+  uint32_t commandId = 1;
+  size_t legacyBytes = 0;
+
+  BenchResult setTemp = runBenchmark("CommandEncoder SET_TEMP", BENCH_ITERATIONS, [&]()
+                                     {
+    encoder.begin(apiKey);
+    encoder.addSetTemp(commandId++, zone.c_str(), 21.5f);
+    encoder.finish(); });
+  runBenchmark("legacy ArduinoJson SET_TEMP", BENCH_ITERATIONS, [&]()
+               { legacyBytes = legacySetTemp(commandId++, zone, 21.5f).bytesCopied; });
+  compareBytes("CommandEncoder SET_TEMP", legacyBytes);
+
+  BenchResult liveData = runBenchmark("CommandEncoder GET_LIVE_DATA", BENCH_ITERATIONS, [&]()
+                                      {
+    encoder.begin(apiKey);
+    encoder.addGetLiveData(commandId++);
+    encoder.finish(); });
+  runBenchmark("legacy ArduinoJson GET_LIVE_DATA", BENCH_ITERATIONS, [&]()
+               { legacyBytes = legacyGetLiveData(commandId++).bytesCopied; });
+  compareBytes("CommandEncoder GET_LIVE_DATA", legacyBytes);
+
+#if BENCH_HEAP_TRACKING
+  TEST_ASSERT_EQUAL_FLOAT(0, setTemp.allocationsPerOp);
+  TEST_ASSERT_EQUAL_FLOAT(0, liveData.allocationsPerOp);
+#else
+  (void)setTemp;
+  (void)liveData;
+#endif
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_matches_legacy_frames);
+  RUN_TEST(test_escapes_zone_names);
+  RUN_TEST(test_rolls_back_commands_that_do_not_fit);
+  RUN_TEST(test_bytes_copied_and_time_per_command);
+  return UNITY_END();
+}
@@ -0,0 +1,181 @@
+// JsonArena tests and soak:
+//   pio test -e native -f test_json_arena -v
+// Runs 100k hub messages through arena-backed documents, the way
+// handleWebSocketMessage does, next to the per-message heap documents they
+// replaced. The arena path must never touch the heap, so nothing can
+// fragment the ESP32's largest free block; on the host the soak checks for
+// zero allocations, no live heap growth and a flat arena peak instead.
+#include <unity.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "../support/bench.h"
+#include "../support/hub_payloads.h"
+#include "json_arena.h"
+
+#define SOAK_ZONES 16
+
+static const uint32_t checkpoints[] = {1000, 10000, 100000};
+
+void setUp() {}
+void tearDown() {}
+
+static void test_allocations_are_aligned_and_bounded()
+{
+  JsonArena arena;
+  TEST_ASSERT_TRUE(arena.reserve(64));
+
+  uint8_t *first = (uint8_t *)arena.allocate(3);
+  uint8_t *second = (uint8_t *)arena.allocate(8);
+  TEST_ASSERT_NOT_EQUAL(nullptr, first);
+  TEST_ASSERT_EQUAL_INT(8, second - first);
+
+  TEST_ASSERT_EQUAL(nullptr, arena.allocate(64));
+  TEST_ASSERT_EQUAL_size_t(16, arena.mark()); // A failed allocation leaves the arena as it was
+  TEST_ASSERT_NOT_EQUAL(nullptr, arena.allocate(48));
+  TEST_ASSERT_EQUAL_size_t(64, arena.getPeak());
+}
+
+static void test_only_the_last_allocation_grows()
+{
+  JsonArena arena;
+  TEST_ASSERT_TRUE(arena.reserve(128));
+
+  void *first = arena.allocate(16);
+  void *second = arena.allocate(16);
+  TEST_ASSERT_EQUAL(second, arena.reallocate(second, 64));
+  TEST_ASSERT_EQUAL_size_t(80, arena.mark());
+  TEST_ASSERT_EQUAL(nullptr, arena.reallocate(first, 32));
+  TEST_ASSERT_EQUAL(nullptr, arena.reallocate(second, 128));
+}
+
+static void test_scopes_rewind_nested_allocations()
+{
+  JsonArena arena;
+  TEST_ASSERT_TRUE(arena.reserve(256));
+  arena.allocate(8);
+  {
+    ArenaScope outer(arena);
+    arena.allocate(32);
+    {
+      ArenaScope inner(arena);
+      arena.allocate(64);
+    }
+    TEST_ASSERT_EQUAL_size_t(40, arena.mark());
+  }
+  TEST_ASSERT_EQUAL_size_t(8, arena.mark());
+  TEST_ASSERT_EQUAL_size_t(104, arena.getPeak());
+}
+
+// A GET_ZONES reply handled as handleWebSocketMessage does: envelope and zone
+// list in arena documents, the response unescaped in place in the payload
+static int arenaMessage(JsonArena &arena, char *payload, size_t length)
+{
+  ArenaScope scope(arena);
+  ArenaJsonDocument envelope(1024, ArenaAllocator(arena));
+  if (deserializeJson(envelope, payload, length))
+    return -1;
+
+  char *response = (char *)envelope["response"].as<const char *>();
+  ArenaJsonDocument zoneDoc(1024, ArenaAllocator(arena));
+  if (!response || deserializeJson(zoneDoc, response))
+    return -1;
+
+  int zones = 0;
+  for (JsonPair zone : zoneDoc.as<JsonObject>())
+    zones += zone.value().as<int>() > 0;
+  return zones;
+}
+
+// The same reply as the code before the arena handled it: documents and
+// String copies on the heap for every message
+static int legacyMessage(const char *payload, size_t length)
+{
+  StaticJsonDocument<1024> doc;
+  if (deserializeJson(doc, payload, length))
+    return -1;
+
+  String response = doc["response"].as<const char *>();
+  DynamicJsonDocument zoneDoc(1024);
+  if (deserializeJson(zoneDoc, response.c_str()))
+    return -1;
+
+  int zones = 0;
+  for (JsonPair zone : zoneDoc.as<JsonObject>())
+  {
+    String name = zone.key().c_str();
+    zones += name.length() > 0 && zone.value().as<int>() > 0;
+  }
+  return zones;
+}
+
+static void test_soak_stays_flat()
+{
+  JsonArena arena;
+  TEST_ASSERT_TRUE(arena.reserve(HUB_JSON_ARENA_SIZE));
+
+  std::string reply = zonesReply(1, SOAK_ZONES);
+  std::vector<char> payload(reply.size() + 1);
+  size_t peaks[3];
+  int64_t liveBytes[3];
+
+  int64_t heapAtStart = heapCounters.bytes.load();
+  resetHeapCounters();
+  uint32_t messages = 0;
+  uint32_t failures = 0;
+  for (size_t n = 0; n < 3; n++)
+  {
+    for (; messages < checkpoints[n]; messages++)
+    {
+      // Replies are unescaped in place, so each message gets a fresh copy
+      memcpy(payload.data(), reply.c_str(), reply.size() + 1);
+      if (arenaMessage(arena, payload.data(), reply.size()) != SOAK_ZONES || arena.mark() != 0)
+        failures++;
+    }
+    peaks[n] = arena.getPeak();
+    liveBytes[n] = heapCounters.bytes.load() - heapAtStart;
+    printf("%-40s %9u messages %9llu allocs %6lld B heap growth %6zu B arena peak\n", "arena soak", (unsigned)messages,
+           (unsigned long long)heapAllocations(), (long long)liveBytes[n], peaks[n]);
+  }
+
+  TEST_ASSERT_EQUAL_UINT32(0, failures);
+  TEST_ASSERT_EQUAL_size_t(peaks[0], peaks[2]);
+  TEST_ASSERT_TRUE(peaks[2] <= HUB_JSON_ARENA_SIZE);
+#if BENCH_HEAP_TRACKING
+  TEST_ASSERT_EQUAL_UINT32(0, heapAllocations());
+  TEST_ASSERT_EQUAL_INT(0, liveBytes[2]);
+#endif
+}
+
+static void test_legacy_soak_for_comparison()
+{
+  std::string reply = zonesReply(1, SOAK_ZONES);
+  int64_t heapAtStart = heapCounters.bytes.load();
+  resetHeapCounters();
+  uint32_t messages = 0;
+  uint32_t failures = 0;
+  for (uint32_t checkpoint : checkpoints)
+  {
+    for (; messages < checkpoint; messages++)
+    {
+      if (legacyMessage(reply.c_str(), reply.size()) != SOAK_ZONES)
+        failures++;
+    }
+    printf("%-40s %9u messages %9llu allocs %6lld B heap growth %6zu B peak\n", "legacy heap documents",
+           (unsigned)messages, (unsigned long long)heapAllocations(),
+           (long long)(heapCounters.bytes.load() - heapAtStart), heapPeakGrowth(heapAtStart));
+  }
+
+  TEST_ASSERT_EQUAL_UINT32(0, failures);
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_allocations_are_aligned_and_bounded);
+  RUN_TEST(test_only_the_last_allocation_grows);
+  RUN_TEST(test_scopes_rewind_nested_allocations);
+  RUN_TEST(test_soak_stays_flat);
+  RUN_TEST(test_legacy_soak_for_comparison);
+  return UNITY_END();
+}
@@ -0,0 +1,171 @@
+// GET_LIVE_DATA parser tests and benchmarks:
+//   pio test -e native -f test_live_data_parser -v
+// Checks every device comes through for 10, 50 and 200 devices, that a device
+// whose name does not fit is left out, and prints
+// parse time and peak heap next to the DynamicJsonDocument parse it replaced.
+#include <unity.h>
+#include <math.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <ArduinoJson.h>
+#include "../support/bench.h"
+#include "../support/hub_payloads.h"
+#include "live_data_parser.h"
+
+#define BENCH_ITERATIONS 1000
+
+static const int deviceCounts[] = {10, 50, 200};
+
+struct CollectedDevices
+{
+  int count;
+  int mismatches;
+};
+
+// Checks each device against what liveDataReply wrote for its index
+static void checkDevice(const LiveDeviceData &device, void *context)
+{
+  CollectedDevices *collected = (CollectedDevices *)context;
+  int i = collected->count++;
+  if (strcmp(device.zoneName, benchZoneName(i).c_str()) != 0 ||
+      fabsf(device.actualTemp - (float)(18.0 + (i % 50) / 10.0)) > 0.01f ||
+      fabsf(device.setTemp - (float)(20.0 + (i % 4) / 2.0)) > 0.01f ||
+      device.heatOn != (i % 3 == 0) || device.standby || device.holdOn)
+    collected->mismatches++;
+}
+
+static void countDevice(const LiveDeviceData &, void *context)
+{
+  (*(int *)context)++;
+}
+
+// The parse this replaced: the unescaped response copied into a String, then
+// filtered into a 32 KB DynamicJsonDocument
+static int legacyParse(const std::string &response)
+{
+  String copy(response.c_str());
+  StaticJsonDocument<128> filter;
+  filter["devices"][0]["ZONE_NAME"] = true;
+  filter["devices"][0]["ACTUAL_TEMP"] = true;
+
+  DynamicJsonDocument responseDoc(32768);
+  if (deserializeJson(responseDoc, copy.c_str(), copy.length(), DeserializationOption::Filter(filter)))
+    return -1;
+
+  int devices = 0;
+  JsonArray deviceArray = responseDoc["devices"];
+  for (JsonObject device : deviceArray)
+  {
+    String zoneName = device["ZONE_NAME"].as<String>();
+    if (zoneName.length() > 0)
+      devices++;
+  }
+  return devices;
+}
+
+// The "response" string of a reply as doc["response"] used to return it
+static std::string unescapedResponse(const std::string &reply)
+{
+  size_t start = reply.find("\"response\":\"") + strlen("\"response\":\"");
+  std::string response;
+  for (size_t i = start; i < reply.size() - 2; i++)
+  {
+    if (reply[i] == '\\')
+      i++;
+    response += reply[i];
+  }
+  return response;
+}
+
+void setUp() {}
+void tearDown() {}
+
+static void test_reports_every_device()
+{
+  for (int devices : deviceCounts)
+  {
+    std::string reply = liveDataReply(2, devices);
+    CollectedDevices collected = {0, 0};
+
+    int reported = parseLiveData((const uint8_t *)reply.data(), reply.size(), checkDevice, &collected);
+
+    TEST_ASSERT_EQUAL_INT(devices, reported);
+    TEST_ASSERT_EQUAL_INT(devices, collected.count);
+    TEST_ASSERT_EQUAL_INT(0, collected.mismatches);
+  }
+}
+
+static void test_rejects_truncated_payload()
+{
+  std::string reply = liveDataReply(2, 10);
+  int count = 0;
+
+  TEST_ASSERT_EQUAL_INT(-1, parseLiveData((const uint8_t *)reply.data(), reply.size() / 2, countDevice, &count));
+}
+
+// Three devices, the second named benchZoneName(1) padded to length characters
+static std::string replyWithNameLength(size_t length)
+{
+  std::string reply = liveDataReply(2, 3);
+  std::string name = benchZoneName(1);
+  reply.insert(reply.find("Zone 2 ") + strlen("Zone 2 "), std::string(length - name.size(), 'x'));
+  return reply;
+}
+
+static void test_skips_names_that_do_not_fit()
+{
+  std::string reply = replyWithNameLength(LIVE_DATA_MAX_ZONE_NAME - 1);
+  int count = 0;
+  int skipped = -1;
+  TEST_ASSERT_EQUAL_INT(3, parseLiveData((const uint8_t *)reply.data(), reply.size(), countDevice, &count, &skipped));
+  TEST_ASSERT_EQUAL_INT(0, skipped);
+
+  // A cut-off name would be stored under a zone the hub does not have
+  reply = replyWithNameLength(LIVE_DATA_MAX_ZONE_NAME);
+  count = 0;
+  TEST_ASSERT_EQUAL_INT(2, parseLiveData((const uint8_t *)reply.data(), reply.size(), countDevice, &count, &skipped));
+  TEST_ASSERT_EQUAL_INT(2, count);
+  TEST_ASSERT_EQUAL_INT(1, skipped);
+}
+
+static void test_parse_time_and_peak_heap()
+{
+  size_t streamingPeak[3];
+  for (size_t n = 0; n < 3; n++)
+  {
+    int devices = deviceCounts[n];
+    std::string reply = liveDataReply(2, devices);
+    std::string response = unescapedResponse(reply);
+    int count = 0;
+    int legacyCount = 0;
+    char name[64];
+
+    snprintf(name, sizeof(name), "parseLiveData devices=%d (%zuB)", devices, reply.size());
+    BenchResult streaming = runBenchmark(name, BENCH_ITERATIONS, [&]()
+                                         { parseLiveData((const uint8_t *)reply.data(), reply.size(), countDevice, &count); });
+    snprintf(name, sizeof(name), "legacy DynamicJsonDocument devices=%d", devices);
+    runBenchmark(name, BENCH_ITERATIONS, [&]()
+                 { legacyCount = legacyParse(response); });
+
+    TEST_ASSERT_EQUAL_INT(devices * (BENCH_ITERATIONS + 1), count);
+    TEST_ASSERT_EQUAL_INT(devices, legacyCount);
+    streamingPeak[n] = streaming.peakHeap;
+#if BENCH_HEAP_TRACKING
+    TEST_ASSERT_EQUAL_FLOAT(0, streaming.allocationsPerOp);
+#endif
+  }
+
+  // Bounded no matter how many devices there are
+  TEST_ASSERT_EQUAL_size_t(streamingPeak[0], streamingPeak[2]);
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_reports_every_device);
+  RUN_TEST(test_rejects_truncated_payload);
+  RUN_TEST(test_skips_names_that_do_not_fit);
+  RUN_TEST(test_parse_time_and_peak_heap);
+  return UNITY_END();
+}
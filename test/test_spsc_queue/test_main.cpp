@@ -0,0 +1,191 @@
+// SpscQueue stress tests on std::thread:
+//   pio test -e native -f test_spsc_queue -v
+// and under ThreadSanitizer, which reports any race on the queue indices:
+//   pio test -e native_tsan -f test_spsc_queue -v
+// Runs the hub task / loop() split with real threads: commands one way,
+// events the other, through queues of the sizes the firmware uses. Every
+// item must arrive once, in order and intact.
+#include <unity.h>
+#include <string.h>
+#include <thread>
+#include "../support/bench.h"
+#include "spsc_queue.h"
+#include "hub_task.h"
+
+#define STRESS_ITEMS 1000000
+#define ROUND_TRIPS 200000
+
+void setUp() {}
+void tearDown() {}
+
+// Fills the event so a torn copy shows up as a mismatch
+static void fillEvent(HubEvent &event, uint32_t sequence)
+{
+  event.type = HUB_EVENT_READING;
+  event.status = COMMAND_OK;
+  event.value = sequence;
+  event.actualTemp = (float)(sequence % 1000) / 10.0f;
+  event.setTemp = event.actualTemp + 1.0f;
+  event.flags = sequence & 0x0F;
+  memset(event.zone, 'a' + sequence % 26, sizeof(event.zone) - 1);
+  event.zone[sizeof(event.zone) - 1] = '\0';
+}
+
+static bool eventIntact(const HubEvent &event, uint32_t sequence)
+{
+  HubEvent expected;
+  fillEvent(expected, sequence);
+  return event.type == expected.type && event.value == expected.value && event.actualTemp == expected.actualTemp &&
+         event.setTemp == expected.setTemp && event.flags == expected.flags &&
+         memcmp(event.zone, expected.zone, sizeof(event.zone)) == 0;
+}
+
+static void test_full_and_empty()
+{
+  SpscQueue<uint32_t, 4> queue;
+  uint32_t item = 0;
+
+  TEST_ASSERT_FALSE(queue.pop(item));
+  for (uint32_t i = 0; i < 4; i++)
+    TEST_ASSERT_TRUE(queue.push(i));
+  TEST_ASSERT_FALSE(queue.push(4));
+
+  for (uint32_t i = 0; i < 4; i++)
+  {
+    TEST_ASSERT_TRUE(queue.pop(item));
+    TEST_ASSERT_EQUAL_UINT32(i, item);
+  }
+  TEST_ASSERT_FALSE(queue.pop(item));
+  TEST_ASSERT_TRUE(queue.push(5)); // Wraps around
+}
+
+// The hub task posting readings while loop() drains them
+static void test_events_arrive_in_order_and_intact()
+{
+  static SpscQueue<HubEvent, HUB_EVENT_QUEUE_SIZE> events;
+  uint32_t received = 0;
+  uint32_t outOfOrder = 0;
+  uint32_t torn = 0;
+
+  auto start = std::chrono::steady_clock::now();
+  std::thread hubTask([]()
+                      {
+    HubEvent event;
+    for (uint32_t sequence = 0; sequence < STRESS_ITEMS; sequence++)
+    {
+      fillEvent(event, sequence);
+      while (!events.push(event))
+        std::this_thread::yield();
+    } });
+
+  HubEvent event;
+  while (received < STRESS_ITEMS)
+  {
+    if (!events.pop(event))
+    {
+      std::this_thread::yield();
+      continue;
+    }
+    if (event.value != received)
+      outOfOrder++;
+    if (!eventIntact(event, event.value))
+      torn++;
+    received++;
+  }
+  hubTask.join();
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  printf("%-40s %12.1f ns/item %9u items\n", "SpscQueue<HubEvent> cross-thread", seconds * 1e9 / STRESS_ITEMS,
+         (unsigned)STRESS_ITEMS);
+
+  TEST_ASSERT_EQUAL_UINT32(0, outOfOrder);
+  TEST_ASSERT_EQUAL_UINT32(0, torn);
+  TEST_ASSERT_FALSE(events.pop(event));
+}
+
+// Commands out to the hub task and a reply back for each, both queues busy at once
+static void test_commands_and_replies_round_trip()
+{
+  static SpscQueue<HubCommand, HUB_COMMAND_QUEUE_SIZE> commands;
+  static SpscQueue<HubEvent, HUB_EVENT_QUEUE_SIZE> replies;
+
+  std::thread hubTask([]()
+                      {
+    HubCommand command;
+    HubEvent reply = {};
+    reply.type = HUB_EVENT_REPLY;
+    for (uint32_t handled = 0; handled < ROUND_TRIPS;)
+    {
+      if (!commands.pop(command))
+      {
+        std::this_thread::yield();
+        continue;
+      }
+      reply.value = command.commandId;
+      reply.status = command.on ? COMMAND_OK : COMMAND_FAILED;
+      while (!replies.push(reply))
+        std::this_thread::yield();
+      handled++;
+    } });
+
+  uint32_t sent = 0;
+  uint32_t answered = 0;
+  uint32_t mismatched = 0;
+  HubCommand command = {};
+  HubEvent reply;
+  while (answered < ROUND_TRIPS)
+  {
+    // Keep several commands in flight, like a burst of HTTP requests
+    bool progressed = false;
+    if (sent < ROUND_TRIPS)
+    {
+      command.commandId = sent + 1;
+      command.on = sent % 2;
+      if (commands.push(command))
+      {
+        sent++;
+        progressed = true;
+      }
+    }
+    if (replies.pop(reply))
+    {
+      if (reply.value != answered + 1 || (reply.status == COMMAND_OK) != (answered % 2 == 1))
+        mismatched++;
+      answered++;
+      progressed = true;
+    }
+    if (!progressed)
+      std::this_thread::yield();
+  }
+  hubTask.join();
+
+  TEST_ASSERT_EQUAL_UINT32(ROUND_TRIPS, sent);
+  TEST_ASSERT_EQUAL_UINT32(0, mismatched);
+}
+
+static void test_push_pop_cost()
+{
+  static SpscQueue<HubEvent, HUB_EVENT_QUEUE_SIZE> events;
+  HubEvent event;
+  fillEvent(event, 1);
+
+  BenchResult result = runBenchmark("SpscQueue<HubEvent> push+pop", STRESS_ITEMS, [&]()
+                                    {
+    events.push(event);
+    events.pop(event); });
+
+#if BENCH_HEAP_TRACKING
+  TEST_ASSERT_EQUAL_FLOAT(0, result.allocationsPerOp);
+#else
+  (void)result;
+#endif
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_full_and_empty);
+  RUN_TEST(test_events_arrive_in_order_and_intact);
+  RUN_TEST(test_commands_and_replies_round_trip);
+  RUN_TEST(test_push_pop_cost);
+  return UNITY_END();
+}
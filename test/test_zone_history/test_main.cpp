@@ -0,0 +1,91 @@
+// Zone history tests:
+//   pio test -e native -f test_zone_history -v
+// Feeds readings with the timing jitter of the adaptive poll and checks they
+// still take one byte per sample, and that times and values read back.
+#include <unity.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "zone_history.h"
+
+#define JITTER_SECONDS 3
+#define POLL_SECONDS 10
+
+struct CollectedSamples
+{
+  int count;
+  int offGrid; // Times not on the HISTORY_SAMPLE_INTERVAL grid
+  uint32_t times[4];
+  float temperatures[4];
+};
+
+static void collectSample(uint32_t time, float temperature, void *context)
+{
+  CollectedSamples *collected = (CollectedSamples *)context;
+  if (time % HISTORY_SAMPLE_INTERVAL)
+    collected->offGrid++;
+  if (collected->count < 4)
+  {
+    collected->times[collected->count] = time;
+    collected->temperatures[collected->count] = temperature;
+  }
+  collected->count++;
+}
+
+void setUp()
+{
+  reserveZoneHistory();
+}
+
+void tearDown() {}
+
+static void test_jittered_readings_take_one_byte()
+{
+  // Well past what the ring holds, so the retained samples fill all of it
+  const int zoneId = 0;
+  srand(1);
+  uint32_t time = 1000;
+  for (int i = 0; i < 40000; i++)
+  {
+    time += POLL_SECONDS - JITTER_SECONDS + rand() % (2 * JITTER_SECONDS + 1);
+    recordZoneHistory(zoneId, time, 20.0f + (i / 60 % 5) / 10.0f);
+  }
+
+  CollectedSamples collected = {};
+  forEachZoneHistorySample(zoneId, 0, UINT32_MAX, collectSample, &collected);
+  float bytesPerSample = (float)HISTORY_BYTES_PER_ZONE / collected.count;
+  printf("%-40s %6d samples %6.2f B/sample, block headers included\n", "jittered readings", collected.count,
+         bytesPerSample);
+
+  TEST_ASSERT_EQUAL_INT(0, collected.offGrid);
+  // One byte per sample plus the 8-byte block headers and keyframes; two
+  // bytes per sample, as irregular deltas cost, come to about 2.5
+  TEST_ASSERT_TRUE(bytesPerSample < 1.5f);
+}
+
+static void test_times_and_values_read_back()
+{
+  const int zoneId = 1;
+  recordZoneHistory(zoneId, 125, 19.5f);
+  recordZoneHistory(zoneId, 170, 30.0f); // Same interval as the first, dropped
+  recordZoneHistory(zoneId, 181, 19.7f);
+  recordZoneHistory(zoneId, 365, 19.2f); // Two intervals missed
+
+  CollectedSamples collected = {};
+  forEachZoneHistorySample(zoneId, 0, UINT32_MAX, collectSample, &collected);
+
+  TEST_ASSERT_EQUAL_INT(3, collected.count);
+  TEST_ASSERT_EQUAL_UINT32(120, collected.times[0]);
+  TEST_ASSERT_EQUAL_UINT32(180, collected.times[1]);
+  TEST_ASSERT_EQUAL_UINT32(360, collected.times[2]);
+  TEST_ASSERT_EQUAL_FLOAT(19.5f, collected.temperatures[0]);
+  TEST_ASSERT_EQUAL_FLOAT(19.7f, collected.temperatures[1]);
+  TEST_ASSERT_EQUAL_FLOAT(19.2f, collected.temperatures[2]);
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_jittered_readings_take_one_byte);
+  RUN_TEST(test_times_and_values_read_back);
+  return UNITY_END();
+}
@@ -0,0 +1,222 @@
+// Zone endpoint routing tests and benchmarks:
+//   pio test -e native -f test_zone_routing -v
+// Prints per-request routing time for 8, 32 and 64 zones, next to the four
+// exact-URI handlers per zone it replaced, and fails if it grows with the
+// zone count.
+#include <unity.h>
+#include <string>
+#include "../support/bench.h"
+
+// The handlers reach into the command, cache and deferred-response modules,
+// which are faked below, so the module is built here
+#include "../../src/zone_routes.cpp"
+
+static int setTemperatureRequests = 0;
+static int standbyRequests = 0;
+static int refreshes = 0;
+static uint8_t zoneFlags = ZONE_HAS_READING | ZONE_HAS_STATE | ZONE_HEAT_ON;
+
+bool requestSetTemperature(int, float)
+{
+  setTemperatureRequests++;
+  return true;
+}
+
+bool requestStandby(int, bool)
+{
+  standbyRequests++;
+  return true;
+}
+
+// Every zone has a fresh reading, so /get_temp answers straight away
+CacheResult lookupZoneState(int, ZoneState &state)
+{
+  state.actualTemp = 20.5f;
+  state.setTemp = 21.0f;
+  state.flags = zoneFlags;
+  state.updatedAt = millis();
+  return CACHE_FRESH;
+}
+
+uint32_t refreshLiveData(uint8_t, CommandCallback)
+{
+  refreshes++;
+  return 1;
+}
+
+uint32_t deferResponse(unsigned long, DeferredHandler)
+{
+  return 0;
+}
+
+void resolveDeferredResponse(uint32_t) {}
+void sendDeferredResponse(WiFiClient &, int, const char *, const String &) {}
+void recordHttpLatency(HttpRoute, uint32_t) {}
+void recordBootMilestone(BootMilestone) {}
+
+#define BENCH_ITERATIONS 20000
+
+static const int zoneCounts[] = {8, 32, 64};
+
+// Path segment for a zone name, encoded the way clients send it
+static std::string encodeZone(const char *name)
+{
+  std::string encoded;
+  for (const char *c = name; *c; c++)
+  {
+    if (isalnum((unsigned char)*c))
+    {
+      encoded += *c;
+    }
+    else if (*c == ' ')
+    {
+      encoded += '+';
+    }
+    else
+    {
+      char escape[4];
+      snprintf(escape, sizeof(escape), "%%%02X", (unsigned char)*c);
+      encoded += escape;
+    }
+  }
+  return encoded;
+}
+
+static std::string zoneName(int index)
+{
+  char name[MAX_ZONE_NAME];
+  snprintf(name, sizeof(name), "Room %d \"%s\"", index + 1, index % 2 ? "Upstairs" : "Hall");
+  return name;
+}
+
+// Fills the zone table up to count zones
+static void addZones(int count)
+{
+  for (int i = getZoneCount(); i < count; i++)
+    TEST_ASSERT_EQUAL_INT(i, addHubZone(0, zoneName(i).c_str()));
+}
+
+// What createHttpEndpoints used to do: four exact-URI handlers per zone, each
+// holding its own copy of the zone name
+static void registerLegacyRoutes(WebServer &legacy, int count)
+{
+  static const char *const prefixes[] = {"/standby_on/", "/standby_off/", "/set_temp/", "/get_temp/"};
+  for (int i = 0; i < count; i++)
+  {
+    String zone(zoneName(i));
+    for (const char *prefix : prefixes)
+    {
+      legacy.on(String(prefix) + String(encodeZone(zone.c_str())), [&legacy, zone]()
+                { legacy.send(200, "text/plain", zone); });
+    }
+  }
+}
+
+void setUp()
+{
+  server.lastCode = 0;
+  server.body.clear();
+  server.requestArgs.clear();
+}
+
+void tearDown() {}
+
+static void test_dispatches_each_action()
+{
+  addZones(2);
+  std::string zone = encodeZone(zoneName(1).c_str());
+
+  TEST_ASSERT_TRUE(server.handleRequest(HTTP_GET, String("/get_temp/" + zone)));
+  TEST_ASSERT_EQUAL_INT(200, server.lastCode);
+  TEST_ASSERT_EQUAL_STRING("{\"zone\":\"Room 2 \\\"Upstairs\\\"\",\"temperature\":20.5}", server.body.c_str());
+
+  TEST_ASSERT_TRUE(server.handleRequest(HTTP_GET, String("/zone/" + zone)));
+  TEST_ASSERT_EQUAL_INT(200, server.lastCode);
+  TEST_ASSERT_TRUE(server.body.find("\"set_temp\":21.0") != std::string::npos);
+
+  server.requestArgs["temp"] = "21.5";
+  TEST_ASSERT_TRUE(server.handleRequest(HTTP_GET, String("/set_temp/" + zone)));
+  TEST_ASSERT_EQUAL_INT(200, server.lastCode);
+  TEST_ASSERT_EQUAL_INT(1, setTemperatureRequests);
+
+  TEST_ASSERT_TRUE(server.handleRequest(HTTP_GET, String("/standby_on/" + zone)));
+  TEST_ASSERT_TRUE(server.handleRequest(HTTP_GET, String("/standby_off/" + zone)));
+  TEST_ASSERT_EQUAL_INT(2, standbyRequests);
+}
+
+// Restored after a reboot: only the temperature is known
+static void test_zone_omits_unreported_state()
+{
+  addZones(2);
+  std::string zone = encodeZone(zoneName(0).c_str());
+
+  zoneFlags = ZONE_HAS_READING;
+  TEST_ASSERT_TRUE(server.handleRequest(HTTP_GET, String("/zone/" + zone)));
+  zoneFlags = ZONE_HAS_READING | ZONE_HAS_STATE | ZONE_HEAT_ON;
+
+  TEST_ASSERT_EQUAL_INT(200, server.lastCode);
+  TEST_ASSERT_TRUE(server.body.find("\"temperature\":20.5") != std::string::npos);
+  TEST_ASSERT_TRUE(server.body.find("set_temp") == std::string::npos);
+  TEST_ASSERT_TRUE(server.body.find("standby") == std::string::npos);
+  TEST_ASSERT_TRUE(server.body.find("heat_on") == std::string::npos);
+}
+
+static void test_rejects_unknown_zones_and_paths()
+{
+  addZones(2);
+
+  TEST_ASSERT_TRUE(server.handleRequest(HTTP_GET, "/get_temp/Attic"));
+  TEST_ASSERT_EQUAL_INT(404, server.lastCode);
+
+  server.lastCode = 0;
+  TEST_ASSERT_TRUE(server.handleRequest(HTTP_GET, "/set_temp/Room+1+%22Hall%22"));
+  TEST_ASSERT_EQUAL_INT(400, server.lastCode); // Known zone, missing temp
+
+  TEST_ASSERT_FALSE(server.handleRequest(HTTP_GET, "/zones"));
+  TEST_ASSERT_FALSE(server.handleRequest(HTTP_POST, "/get_temp/Room+1+%22Hall%22"));
+}
+
+static void test_routing_time_stays_flat()
+{
+  BenchResult routed[3];
+  for (size_t n = 0; n < 3; n++)
+  {
+    int zones = zoneCounts[n];
+    addZones(zones);
+
+    // The last zone added is the worst case for the linear handler list
+    String uri("/get_temp/" + encodeZone(zoneName(zones - 1).c_str()));
+    char name[64];
+
+    snprintf(name, sizeof(name), "ZoneRequestHandler zones=%d", zones);
+    routed[n] = runBenchmark(name, BENCH_ITERATIONS, [&]()
+                             { server.handleRequest(HTTP_GET, uri); });
+    TEST_ASSERT_EQUAL_INT(200, server.lastCode);
+
+    WebServer legacy;
+    int64_t before = heapCounters.bytes.load();
+    registerLegacyRoutes(legacy, zones);
+    printf("%-40s %12lld B heap for %d handlers\n", "legacy server.on() registration",
+           (long long)(heapCounters.bytes.load() - before), zones * 4);
+
+    snprintf(name, sizeof(name), "legacy server.on() x4 zones=%d", zones);
+    runBenchmark(name, BENCH_ITERATIONS, [&]()
+                 { legacy.handleRequest(HTTP_GET, uri); });
+    TEST_ASSERT_EQUAL_INT(200, legacy.lastCode);
+  }
+
+  // Hash lookup: eight times the zones must not cost anywhere near eight times as much
+  TEST_ASSERT_LESS_THAN(routed[0].nsPerOp * 2, routed[2].nsPerOp);
+}
+
+int main()
+{
+  setupZoneRoutes();
+
+  UNITY_BEGIN();
+  RUN_TEST(test_dispatches_each_action);
+  RUN_TEST(test_zone_omits_unreported_state);
+  RUN_TEST(test_rejects_unknown_zones_and_paths);
+  RUN_TEST(test_routing_time_stays_flat);
+  return UNITY_END();
+}